@@ -21,9 +21,13 @@
 
 #include "arcdist.h"
 
-#include <cmath>                  // for round
+#include <algorithm>              // for sort, min, max
+#include <cmath>                  // for round, sin, cos, sqrt, cbrt, ceil, isfinite
 #include <cstdio>                 // for printf, sscanf
 #include <cstdlib>                // for strtod
+#include <limits>                 // for numeric_limits
+#include <numeric>                // for iota
+#include <vector>                 // for vector
 
 #include <QByteArray>             // for QByteArray
 #include <QString>                // for QString
@@ -32,7 +36,6 @@
 #include "defs.h"
 #include "grtcirc.h"              // for RAD, gcdist, linedistprj, radtomi
 #include "src/core/datetime.h"    // for DateTime
-#include "src/core/logging.h"     // for Fatal
 #include "src/core/textstream.h"  // for TextStream
 
 
@@ -41,69 +44,285 @@
 
 #define BADVAL 999999
 
+void ArcDistanceFilter::SegmentIndex::build(const std::vector<box_t>& boxes)
+{
+  levels_.clear();
+  boxes_.clear();
+  items_.clear();
+  unbounded_.clear();
+
+  std::vector<int> ids;
+  for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
+    const box_t& box = boxes[i];
+    bool finite = true;
+    for (int axis = 0; axis < 3; ++axis) {
+      finite = finite && std::isfinite(box.lo[axis]) && std::isfinite(box.hi[axis]);
+    }
+    if (finite) {
+      ids.push_back(i);
+    } else {
+      unbounded_.push_back(i);
+    }
+  }
+  if (ids.empty()) {
+    return;
+  }
+
+  /*
+   * Sort-tile-recursive packing: order the items into slabs by x, the
+   * slabs into strips by y and the strips by z, then cut the result
+   * into leaves of kFanout items.
+   */
+  auto center_lt = [&boxes](int axis) {
+    return [&boxes, axis](int a, int b)->bool {
+      return (boxes[a].lo[axis] + boxes[a].hi[axis]) < (boxes[b].lo[axis] + boxes[b].hi[axis]);
+    };
+  };
+  const auto n = static_cast<int>(ids.size());
+  const int leaves = (n + kFanout - 1) / kFanout;
+  const auto slabs = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(leaves))));
+  const int slab_size = ((leaves + slabs - 1) / slabs) * kFanout * slabs;
+  const int strip_size = ((leaves + slabs * slabs - 1) / (slabs * slabs)) * kFanout;
+  std::sort(ids.begin(), ids.end(), center_lt(0));
+  for (int slab = 0; slab < n; slab += slab_size) {
+    int slab_end = std::min(n, slab + slab_size);
+    std::sort(ids.begin() + slab, ids.begin() + slab_end, center_lt(1));
+    for (int strip = slab; strip < slab_end; strip += strip_size) {
+      int strip_end = std::min(slab_end, strip + strip_size);
+      std::sort(ids.begin() + strip, ids.begin() + strip_end, center_lt(2));
+    }
+  }
+
+  items_ = ids;
+  for (int id : ids) {
+    boxes_.push_back(boxes[id]);
+  }
+
+  /* Build the levels bottom up by grouping consecutive entries. */
+  std::vector<node_t> level;
+  for (int first = 0; first < n; first += kFanout) {
+    node_t node{boxes_[first], first, std::min(kFanout, n - first)};
+    for (int i = first + 1; i < first + node.count; ++i) {
+      for (int axis = 0; axis < 3; ++axis) {
+        node.box.lo[axis] = std::min(node.box.lo[axis], boxes_[i].lo[axis]);
+        node.box.hi[axis] = std::max(node.box.hi[axis], boxes_[i].hi[axis]);
+      }
+    }
+    level.push_back(node);
+  }
+  levels_.push_back(level);
+  while (levels_.back().size() > kFanout) {
+    const std::vector<node_t>& below = levels_.back();
+    const auto count = static_cast<int>(below.size());
+    level.clear();
+    for (int first = 0; first < count; first += kFanout) {
+      node_t node{below[first].box, first, std::min(kFanout, count - first)};
+      for (int i = first + 1; i < first + node.count; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+          node.box.lo[axis] = std::min(node.box.lo[axis], below[i].box.lo[axis]);
+          node.box.hi[axis] = std::max(node.box.hi[axis], below[i].box.hi[axis]);
+        }
+      }
+      level.push_back(node);
+    }
+    levels_.push_back(level);
+  }
+}
+
+void ArcDistanceFilter::SegmentIndex::query_node(int level, int idx, const double p[3], std::vector<int>* result) const
+{
+  const node_t& node = levels_[level][idx];
+  if (!contains(node.box, p)) {
+    return;
+  }
+  if (level == 0) {
+    for (int i = node.first; i < node.first + node.count; ++i) {
+      if (contains(boxes_[i], p)) {
+        result->push_back(items_[i]);
+      }
+    }
+  } else {
+    for (int i = node.first; i < node.first + node.count; ++i) {
+      query_node(level - 1, i, p, result);
+    }
+  }
+}
+
+/* Append the ids of all boxes that contain p, in no particular order. */
+void ArcDistanceFilter::SegmentIndex::query(const double p[3], std::vector<int>* result) const
+{
+  result->insert(result->end(), unbounded_.cbegin(), unbounded_.cend());
+  if (levels_.empty()) {
+    return;
+  }
+  const int top = static_cast<int>(levels_.size()) - 1;
+  for (int i = 0; i < static_cast<int>(levels_[top].size()); ++i) {
+    query_node(top, i, p, result);
+  }
+}
+
 void ArcDistanceFilter::arcdist_arc_disp_wpt_cb(const Waypoint* arcpt2)
 {
-  static const Waypoint* arcpt1 = nullptr;
-  double prjlat;
-  double prjlon;
-  double frac;
+  const Waypoint* arcpt1 = prev_arcpt;
 
   if (arcpt2 && arcpt2->latitude != BADVAL && arcpt2->longitude != BADVAL &&
       (ptsopt || (arcpt1 &&
                   (arcpt1->latitude != BADVAL && arcpt1->longitude != BADVAL)))) {
-    foreach (Waypoint* waypointp, *global_waypoint_list) {
-      extra_data* ed;
-      if (waypointp->extra_data) {
-        ed = (extra_data*) waypointp->extra_data;
+    /* Arcs from a file are read into reused waypoints, keep a copy of the positions. */
+    arc_seg_t seg{};
+    if (!ptsopt) {
+      seg.lat1 = arcpt1->latitude;
+      seg.lon1 = arcpt1->longitude;
+    }
+    seg.lat2 = arcpt2->latitude;
+    seg.lon2 = arcpt2->longitude;
+    if (!arcfileopt) {
+      seg.arcpt1 = arcpt1;
+      seg.arcpt2 = arcpt2;
+    }
+    arcs.push_back(seg);
+  }
+  prev_arcpt = arcpt2;
+}
+
+/* Same earth centered coordinates as linedistprj uses. */
+void ArcDistanceFilter::arcdist_unit_vector(double lat, double lon, double v[3])
+{
+  lat = RAD(lat);
+  lon = RAD(lon);
+  v[0] = cos(lon) * cos(lat);
+  v[1] = sin(lat);
+  v[2] = sin(lon) * cos(lat);
+}
+
+/*
+ * A cube around the segment that contains every point closer than
+ * pos_dist to it.  All points of the (shorter) arc between the unit
+ * vectors a and b are within sin(t/2) + 1 - cos(t/2) of the chord
+ * midpoint, t being the angle between a and b, and points at an angle
+ * d from the arc are within the chord length 2 sin(d/2) of it.
+ */
+ArcDistanceFilter::SegmentIndex::box_t ArcDistanceFilter::arcdist_seg_box(const arc_seg_t& seg) const
+{
+  constexpr double kMargin = 1.0e-9;
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+
+  double b[3];
+  arcdist_unit_vector(seg.lat2, seg.lon2, b);
+  double mid[3] = {b[0], b[1], b[2]};
+  double radius = 0.0;
+  if (!ptsopt) {
+    double a[3];
+    arcdist_unit_vector(seg.lat1, seg.lon1, a);
+    double cross[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+    if ((cross[0] == 0.0) && (cross[1] == 0.0) && (cross[2] == 0.0) &&
+        ((a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) < 0.0)) {
+      /* linedistprj has no geodesic for antipodal points and matches everything */
+      return {{-kInf, -kInf, -kInf}, {kInf, kInf, kInf}};
+    }
+    double chord2 = 0.0;
+    for (int axis = 0; axis < 3; ++axis) {
+      mid[axis] = (a[axis] + b[axis]) / 2.0;
+      chord2 += (a[axis] - b[axis]) * (a[axis] - b[axis]);
+    }
+    double half_sin = std::sqrt(chord2) / 2.0;
+    double half_cos = std::sqrt(std::max(0.0, 1.0 - half_sin * half_sin));
+    radius = half_sin + (1.0 - half_cos);
+  }
+
+  double angle = std::min(pos_dist / radtomiles(1.0), M_PI);
+  radius += 2.0 * std::sin(angle / 2.0);
+  radius = radius * (1.0 + kMargin) + kMargin;
+
+  SegmentIndex::box_t box;
+  for (int axis = 0; axis < 3; ++axis) {
+    box.lo[axis] = mid[axis] - radius;
+    box.hi[axis] = mid[axis] + radius;
+  }
+  return box;
+}
+
+/*
+ * Find the closest segment for every waypoint.  Segments that can not
+ * be closer than pos_dist are skipped with an R-tree over boxes around
+ * the segments; that doesn't change the result as only a distance
+ * below pos_dist, or the projection in that case, is used.  When
+ * excluding with projection the far waypoints are projected too, so
+ * all segments are tested.  The candidates are visited in arc order so
+ * ties resolve to the same segment as a full scan.
+ */
+void ArcDistanceFilter::arcdist_match_wpts()
+{
+  const bool indexed = !(exclopt && projectopt);
+  SegmentIndex index;
+  if (indexed) {
+    std::vector<SegmentIndex::box_t> boxes;
+    boxes.reserve(arcs.size());
+    for (const auto& seg : arcs) {
+      boxes.push_back(arcdist_seg_box(seg));
+    }
+    index.build(boxes);
+  }
+
+  std::vector<int> candidates;
+  foreach (Waypoint* waypointp, *global_waypoint_list) {
+    auto* ed = new extra_data;
+    ed->distance = BADVAL;
+    waypointp->extra_data = ed;
+
+    candidates.clear();
+    double p[3];
+    arcdist_unit_vector(waypointp->latitude, waypointp->longitude, p);
+    if (indexed && std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2])) {
+      index.query(p, &candidates);
+      std::sort(candidates.begin(), candidates.end());
+    } else {
+      candidates.resize(arcs.size());
+      std::iota(candidates.begin(), candidates.end(), 0);
+    }
+
+    for (int i : candidates) {
+      if (!(ed->distance == BADVAL || projectopt || ed->distance >= pos_dist)) {
+        break;
+      }
+      const arc_seg_t& seg = arcs[i];
+      double dist;
+      double prjlat;
+      double prjlon;
+      double frac;
+      if (ptsopt) {
+        dist = gcdist(RAD(seg.lat2),
+                      RAD(seg.lon2),
+                      RAD(waypointp->latitude),
+                      RAD(waypointp->longitude));
+        prjlat = seg.lat2;
+        prjlon = seg.lon2;
+        frac = 1.0;
       } else {
-        ed = new extra_data;
-        ed->distance = BADVAL;
+        dist = linedistprj(seg.lat1,
+                           seg.lon1,
+                           seg.lat2,
+                           seg.lon2,
+                           waypointp->latitude,
+                           waypointp->longitude,
+                           &prjlat, &prjlon, &frac);
       }
-      if (ed->distance == BADVAL || projectopt || ed->distance >= pos_dist) {
-        double dist;
-        if (ptsopt) {
-          dist = gcdist(RAD(arcpt2->latitude),
-                        RAD(arcpt2->longitude),
-                        RAD(waypointp->latitude),
-                        RAD(waypointp->longitude));
-          prjlat = arcpt2->latitude;
-          prjlon = arcpt2->longitude;
-          frac = 1.0;
-        } else {
-          if (waypointp == nullptr) {
-            fatal(FatalMsg() << "Internal error. Attempt to project through a waypoint that doesn't exist");
-          }
-          if (arcpt1 == nullptr) {
-            fatal(FatalMsg() << "Internal error: Attempt to project waypoint without predecessor");
-          }
-
-          dist = linedistprj(arcpt1->latitude,
-                             arcpt1->longitude,
-                             arcpt2->latitude,
-                             arcpt2->longitude,
-                             waypointp->latitude,
-                             waypointp->longitude,
-                             &prjlat, &prjlon, &frac);
-        }
 
-        /* convert radians to float point statute miles */
-        dist = radtomiles(dist);
-
-        if (ed->distance > dist) {
-          ed->distance = dist;
-          if (projectopt) {
-            ed->prjlatitude = prjlat;
-            ed->prjlongitude = prjlon;
-            ed->frac = frac;
-            ed->arcpt1 = arcpt1;
-            ed->arcpt2 = arcpt2;
-          }
+      /* convert radians to float point statute miles */
+      dist = radtomiles(dist);
+
+      if (ed->distance > dist) {
+        ed->distance = dist;
+        if (projectopt) {
+          ed->prjlatitude = prjlat;
+          ed->prjlongitude = prjlon;
+          ed->frac = frac;
+          ed->arcpt1 = seg.arcpt1;
+          ed->arcpt2 = seg.arcpt2;
         }
-        waypointp->extra_data = ed;
       }
     }
   }
-  arcpt1 = arcpt2;
 }
 
 void ArcDistanceFilter::arcdist_arc_disp_hdr_cb(const route_head* /*unused*/)
@@ -117,6 +336,9 @@ void ArcDistanceFilter::process()
   WayptFunctor<ArcDistanceFilter> arcdist_arc_disp_wpt_cb_f(this, &ArcDistanceFilter::arcdist_arc_disp_wpt_cb);
   RteHdFunctor<ArcDistanceFilter> arcdist_arc_disp_hdr_cb_f(this, &ArcDistanceFilter::arcdist_arc_disp_hdr_cb);
 
+  arcs.clear();
+  prev_arcpt = nullptr;
+
   if (arcfileopt) {
     int fileline = 0;
     QString line;
@@ -162,6 +384,11 @@ void ArcDistanceFilter::process()
     track_disp_all(arcdist_arc_disp_hdr_cb_f, nullptr, arcdist_arc_disp_wpt_cb_f);
   }
 
+  waypt_run_mutation_hook();
+  if (!arcs.empty()) {
+    arcdist_match_wpts();
+  }
+
   unsigned removed = 0;
   foreach (Waypoint* wp, *global_waypoint_list) {
     if (wp->extra_data) {
@@ -209,6 +436,8 @@ void ArcDistanceFilter::process()
     }
   }
   del_marked_wpts();
+  arcs.clear();
+  prev_arcpt = nullptr;
   if (global_opts.verbose_status > 0) {
     printf(MYNAME "-arc: %u waypoint(s) removed.\n", removed);
   }
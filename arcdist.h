@@ -22,6 +22,8 @@
 #ifndef ARCDIST_H_INCLUDED_
 #define ARCDIST_H_INCLUDED_
 
+#include <vector>          // for vector
+
 #include <QVector>         // for QVector
 
 #include "defs.h"    // for ARG_NOMINMAX, ARGTYPE_BOOL, Waypoint (ptr only)
@@ -51,10 +53,62 @@ private:
     const Waypoint* arcpt2;
   };
 
+  /* One segment of the arc, or one vertex if "points" is set. */
+  struct arc_seg_t {
+    double lat1;
+    double lon1;
+    double lat2;
+    double lon2;
+    const Waypoint* arcpt1;             /* nullptr for arcs read from a file */
+    const Waypoint* arcpt2;
+  };
+
+  /*
+   * Static bulk loaded (sort-tile-recursive) R-tree of axis aligned
+   * boxes in earth centered unit sphere coordinates.  Boxes that are
+   * not finite are reported for every query.
+   */
+  class SegmentIndex
+  {
+  public:
+    struct box_t {
+      double lo[3];
+      double hi[3];
+    };
+
+    void build(const std::vector<box_t>& boxes);
+    void query(const double p[3], std::vector<int>* result) const;
+
+  private:
+    struct node_t {
+      box_t box;
+      int first;                        /* first child in the level below, or item */
+      int count;
+    };
+
+    static constexpr int kFanout = 16;
+
+    static bool contains(const box_t& box, const double p[3])
+    {
+      return (p[0] >= box.lo[0]) && (p[0] <= box.hi[0]) &&
+             (p[1] >= box.lo[1]) && (p[1] <= box.hi[1]) &&
+             (p[2] >= box.lo[2]) && (p[2] <= box.hi[2]);
+    }
+    void query_node(int level, int idx, const double p[3], std::vector<int>* result) const;
+
+    std::vector<std::vector<node_t>> levels_;  /* levels_[0] are the leaves */
+    std::vector<box_t> boxes_;                 /* item boxes in leaf order */
+    std::vector<int> items_;                   /* item ids in leaf order */
+    std::vector<int> unbounded_;
+  };
+
   /* Member Functions */
 
   void arcdist_arc_disp_wpt_cb(const Waypoint* arcpt2);
   void arcdist_arc_disp_hdr_cb(const route_head* /*unused*/);
+  static void arcdist_unit_vector(double lat, double lon, double v[3]);
+  SegmentIndex::box_t arcdist_seg_box(const arc_seg_t& seg) const;
+  void arcdist_match_wpts();
 
   /* Data Members */
 
@@ -67,6 +121,9 @@ private:
   char* ptsopt = nullptr;
   char* projectopt = nullptr;
 
+  const Waypoint* prev_arcpt{nullptr};
+  std::vector<arc_seg_t> arcs;
+
   QVector<arglist_t> args = {
     {
       "file", &arcfileopt,  "File containing vertices of arc",
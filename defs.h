@@ -24,8 +24,11 @@
 #include <cstdint>                   // for int32_t, uint32_t
 #include <cstdio>                    // for NULL, fprintf, FILE, stdout
 #include <ctime>                     // for time_t
+#include <functional>                // for function
+#include <memory>                    // for shared_ptr, unique_ptr
 #include <optional>                  // for optional
 #include <utility>                   // for move
+#include <vector>                    // for vector
 
 #include <QByteArray>                // for QByteArray
 #include <QDate>                     // for QDate
@@ -46,6 +49,11 @@
 #include "session.h"                 // for session_t
 #include "src/core/datetime.h"       // for DateTime
 
+namespace gpsbabel
+{
+class NVectorArray;
+} // namespace gpsbabel
+
 
 #define CSTR(qstr) ((qstr).toUtf8().constData())
 #define CSTRc(qstr) ((qstr).toLatin1().constData())
@@ -295,6 +303,13 @@ private:
     */
   };
 
+  // Selects the copy constructor that leaves gc_data and fs empty.
+  struct shallow_copy_t {};
+
+  /* Special Member Functions */
+
+  Waypoint(const Waypoint& other, shallow_copy_t);
+
   /* Data Members */
 
   static Geocache empty_gc_data;
@@ -339,6 +354,7 @@ public:
   void SetCreationTime(qint64 t, qint64 ms = 0);
   Geocache* AllocGCData();
   int EmptyGCData() const;
+  static Waypoint* NewInterpolated(const Waypoint& other);
 
 // mimic std::optional interface, but use our more space
 // efficient wp_flags.
@@ -448,6 +464,7 @@ public:
   //        and/or implement pop_back() a.k.a. removeLast(), and/or pop_front() a.k.a. removeFirst().
   void waypt_del(Waypoint* wpt); // a.k.a. erase()
   void del_marked_wpts();
+  void del_marked_rte_wpts(); // del_marked_wpts() preserving track segments
   // FIXME: Generally it is inefficient to use an element pointer or reference to define the element to be deleted, use iterator instead,
   //        and/or implement pop_back() a.k.a. removeLast(), and/or pop_front() a.k.a. removeFirst().
   void del_rte_waypt(Waypoint* wpt);
@@ -457,10 +474,22 @@ public:
   void copy(WaypointList** dst) const;
   void restore(WaypointList* src);
   void swap(WaypointList& other);
+  void append_range(const_iterator first, const_iterator last); // a.k.a. append(first, last)
+  void splice(WaypointList& other); // move all of other to the end of this list
   template <typename Compare>
-  void sort(Compare cmp) {std::stable_sort(begin(), end(), cmp);}
+  void sort(Compare cmp) {std::stable_sort(begin(), end(), cmp); touch();}
+  // Stable sorts that extract the key of each point once, instead of
+  // chasing both pointers on every comparison.  Strings are ordered as
+  // by QString::operator<.
+  void sort_by_key(qint64 (*key)(const Waypoint*));
+  void sort_by_key(QString (*key)(const Waypoint*));
   template <typename T>
   void waypt_disp_session(const session_t* se, T cb);
+  // Changes whenever the list is modified, never repeats.
+  quint64 generation() const {return generation_;}
+  // Unit n-vectors of the points, built on first use and kept until the
+  // list changes or waypt_invalidate_computed() is called.
+  const gpsbabel::NVectorArray& nvectors() const;
 
   // Expose limited methods for portability.
   // public types
@@ -483,6 +512,28 @@ public:
   using QList<Waypoint*>::rbegin;
   using QList<Waypoint*>::rend;
   using QList<Waypoint*>::size_type;
+
+private:
+  // A run of consecutive points read in the same session.
+  struct session_run_t {
+    const session_t* session;
+    qsizetype first;
+    qsizetype last; // one past the end
+  };
+  struct session_index_t {
+    quint64 generation{0};
+    quint64 epoch{0};
+    std::vector<session_run_t> runs;
+  };
+
+  void touch();
+  // The points of one session, found through the session runs which are
+  // built on first use and kept until the list changes.
+  QList<Waypoint*> session_points(const session_t* se) const;
+
+  quint64 generation_{0};
+  mutable std::shared_ptr<gpsbabel::NVectorArray> nvectors_;
+  mutable std::shared_ptr<session_index_t> session_index_;
 };
 
 void waypt_init();
@@ -498,20 +549,30 @@ void waypt_init_bounds(bounds* bounds);
 bool waypt_bounds_valid(bounds* bounds);
 void waypt_add_to_bounds(bounds* bounds, const Waypoint* waypointp);
 void waypt_compute_bounds(bounds* bounds);
+quint64 waypt_computed_epoch();
+void waypt_invalidate_computed();
 Waypoint* find_waypt_by_name(const QString& name);
 void waypt_flush_all();
 void waypt_deinit();
-void waypt_append(WaypointList* src);
+void waypt_append(WaypointList* src); // moves the points, leaving src empty
 void waypt_backup(WaypointList** head_bak);
 void waypt_restore(WaypointList* head_bak);
 void waypt_swap(WaypointList& other);
+// The hook is run once, just before the global waypoints are next changed
+// or handed out where they could be changed.  Code that changes
+// global_waypoint_list directly must call waypt_run_mutation_hook() first.
+void waypt_set_mutation_hook(std::function<void()> hook);
+void waypt_run_mutation_hook();
 template <typename Compare>
 void waypt_sort(Compare cmp)
 {
   extern WaypointList* global_waypoint_list;
 
+  waypt_run_mutation_hook();
   global_waypoint_list->sort(cmp);
 }
+void waypt_sort_by_key(qint64 (*key)(const Waypoint*));
+void waypt_sort_by_key(QString (*key)(const Waypoint*));
 void waypt_add_url(Waypoint* wpt, const QString& link,
                    const QString& url_link_text);
 void waypt_add_url(Waypoint* wpt, const QString& link,
@@ -531,15 +592,15 @@ template <typename T>
 void
 WaypointList::waypt_disp_session(const session_t* se, T cb)
 {
+  // Iterate over a copy, like foreach, so cb may modify the list.
+  const QList<Waypoint*> points = (se == nullptr) ? static_cast<const QList<Waypoint*>&>(*this) : session_points(se);
   int i = 0;
-  foreach (Waypoint* waypointp, *this) {
-    if ((se == nullptr) || (waypointp->session == se)) {
-      if (global_opts.verbose_status) {
-        i++;
-        waypt_status_disp(waypt_count(), i);
-      }
-      cb(waypointp);
+  for (Waypoint* waypointp : points) {
+    if (global_opts.verbose_status) {
+      i++;
+      waypt_status_disp(waypt_count(), i);
     }
+    cb(waypointp);
   }
   if (global_opts.verbose_status) {
     fprintf(stdout, "\r\n");
@@ -552,6 +613,7 @@ waypt_disp_session(const session_t* se, T cb)
 {
   extern WaypointList* global_waypoint_list;
 
+  waypt_run_mutation_hook();
   global_waypoint_list->waypt_disp_session(se, cb);
 }
 
@@ -561,6 +623,7 @@ waypt_disp_all(T cb)
 {
   extern WaypointList* global_waypoint_list;
 
+  waypt_run_mutation_hook();
   global_waypoint_list->waypt_disp_session(nullptr, cb);
 }
 
@@ -597,6 +660,16 @@ public:
   int line_width;         /* in pixels (sigh).  < 0 is unknown. */
   const session_t* session;	/* pointer to a session struct */
 
+  /* Statistics computed by track_recompute, kept until the waypoint list
+   * changes or waypt_invalidate_computed() is called. */
+  struct computed_cache_t {
+    quint64 generation{0};
+    quint64 epoch{0};
+    computed_trkdata data;
+    std::vector<double> distance;	/* meters from the first point */
+  };
+  mutable std::unique_ptr<computed_cache_t> computed;
+
 public:
   route_head();
   // the default copy constructor and assignment operator are not appropriate as we do deep copy of some members,
@@ -633,7 +706,9 @@ public:
   void copy(RouteList** dst) const;
   void restore(RouteList* src);
   void swap(RouteList& other);
+  void splice(RouteList& other); // move all of other to the end of this list
   void swap_wpts(route_head* rte, WaypointList& other);
+  void splice_wpts(route_head* rte, WaypointList& other);
   template <typename Compare>
   void sort(Compare cmp) {std::sort(begin(), end(), cmp);}
   template <typename T1, typename T2, typename T3>
@@ -692,6 +767,7 @@ void route_del_marked_wpts(route_head* rte);
 void track_del_marked_wpts(route_head* rte);
 void route_swap_wpts(route_head* rte, WaypointList& other);
 void track_swap_wpts(route_head* rte, WaypointList& other);
+void track_splice_wpts(route_head* rte, WaypointList& other);
 //void route_disp(const route_head* rte, waypt_cb); /* template */
 void route_disp(const route_head* rte, std::nullptr_t /* waypt_cb */); /* override to catch nullptr */
 //void route_disp_all(route_hdr, route_trl, waypt_cb); /* template */
@@ -701,29 +777,37 @@ void track_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_c
 void route_flush_all_routes();
 void route_flush_all_tracks();
 void route_deinit();
-void route_append(const RouteList* src);
-void track_append(const RouteList* src);
+void route_append(RouteList* src); // moves the routes, leaving src empty
+void track_append(RouteList* src); // moves the tracks, leaving src empty
 void route_backup(RouteList** head_bak);
 void route_restore(RouteList* head_bak);
 void route_swap(RouteList& other);
+// Like waypt_set_mutation_hook() for the routes and tracks.
+void route_set_mutation_hook(std::function<void()> hook);
+void route_run_mutation_hook();
 template <typename Compare>
 void route_sort(Compare cmp)
 {
   extern RouteList* global_route_list;
 
+  route_run_mutation_hook();
   global_route_list->sort(cmp);
 }
 void track_backup(RouteList** head_bak);
 void track_restore(RouteList* head_bak);
 void track_swap(RouteList& other);
+void track_set_mutation_hook(std::function<void()> hook);
+void track_run_mutation_hook();
 template <typename Compare>
 void track_sort(Compare cmp)
 {
   extern RouteList* global_track_list;
 
+  track_run_mutation_hook();
   global_track_list->sort(cmp);
 }
 computed_trkdata track_recompute(const route_head* trk);
+double track_distance_meters(const route_head* trk, int from, int to);
 
 template <typename T>
 void
@@ -789,6 +873,7 @@ route_disp_all(T1 rh, T2 rt, T3 wc)
 {
   extern RouteList* global_route_list;
 
+  route_run_mutation_hook();
   global_route_list->disp_all(rh, rt, wc);
 }
 
@@ -798,6 +883,7 @@ track_disp_all(T1 rh, T2 rt, T3 wc)
 {
   extern RouteList* global_track_list;
 
+  track_run_mutation_hook();
   global_track_list->disp_all(rh, rt, wc);
 }
 
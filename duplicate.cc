@@ -21,10 +21,11 @@
 
 #include "duplicate.h"
 
+#include <cmath>                 // for fabs, floor, fma, isinf, isnan
 #include <utility>               // for as_const
 
-#include <QList>                 // for QList, QList<>::iterator, QList<>::const_iterator
-#include <QMultiHash>            // for QMultiHash
+#include <QHash>                 // for QHash
+#include <QString>               // for QString
 
 #include "defs.h"
 
@@ -40,45 +41,146 @@ void DuplicateFilter::init()
   }
 }
 
+/*
+ * Duplicates were found by comparing degrees2ddmm values printed with
+ * QString::arg(x, 11, 'f', 3).  quantize computes the same three decimal
+ * rounding numerically: |x| * 1000 rounded to nearest with ties away from
+ * zero, as Qt rounds, evaluated exactly with the fma residual of the
+ * product.  Qt prints "-0.000" for small negative values, which gets a
+ * code of its own.  The codes are even except for that and the
+ * non-finite values.  Values too large for 32 bits are not quantized.
+ */
+bool DuplicateFilter::quantize(double x, int32_t* code)
+{
+  if (std::isnan(x)) {
+    *code = kNaNCode;
+    return true;
+  }
+  if (std::isinf(x)) {
+    *code = (x > 0.0) ? kPosInfCode : kNegInfCode;
+    return true;
+  }
+
+  double m = std::fabs(x);
+  if (m >= kMaxQuantizable) {
+    return false;
+  }
+  double p = m * 1000.0;
+  double e = std::fma(m, 1000.0, -p);  /* m * 1000 == p + e exactly */
+  double f = std::floor(p);
+  double t = (p - f - 0.5) + e;        /* sign of (m * 1000 - f - 0.5) */
+  auto q = static_cast<int32_t>(f) + ((t >= 0.0) ? 1 : 0);
+
+  if (q == 0) {
+    *code = (x < 0.0) ? 1 : 0;
+  } else {
+    *code = (x < 0.0) ? -2 * q : 2 * q;
+  }
+  return true;
+}
+
+uint64_t DuplicateFilter::KeyTable::hash(const dup_key_t& key)
+{
+  /* splitmix64 finalizer */
+  uint64_t z = key.coords ^ (static_cast<uint64_t>(static_cast<uint32_t>(key.name)) * 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void DuplicateFilter::KeyTable::grow(const std::vector<dup_group_t>& groups)
+{
+  slots_.assign(slots_.empty() ? 1024 : slots_.size() * 2, -1);
+  const uint64_t mask = slots_.size() - 1;
+  for (int i = 0; i < static_cast<int>(groups.size()); ++i) {
+    uint64_t slot = hash(groups[i].key) & mask;
+    while (slots_[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = i;
+  }
+}
+
+/* Return the index of the group of key, appending a new group for wpt if there is none. */
+int DuplicateFilter::KeyTable::find_or_insert(const dup_key_t& key, std::vector<dup_group_t>& groups, Waypoint* wpt)
+{
+  if ((groups.size() + 1) * 2 > slots_.size()) {
+    grow(groups);
+  }
+  const uint64_t mask = slots_.size() - 1;
+  uint64_t slot = hash(key) & mask;
+  while (slots_[slot] >= 0) {
+    if (groups[slots_[slot]].key == key) {
+      return slots_[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  slots_[slot] = static_cast<int32_t>(groups.size());
+  groups.push_back({key, wpt, wpt});
+  return slots_[slot];
+}
+
 void DuplicateFilter::process()
 {
-  QMultiHash<QString, Waypoint*> wpthash;
+  /*
+   * The degrees2ddmm stuff is a feeble attempt to get everything rounded
+   * the same way in a precision that's "close enough" for determining
+   * duplicates.  Shortnames are interned, so a key is two integers.
+   * Coordinates that can't be quantized, which don't occur for valid
+   * positions, fall back to a key with the formatted text.
+   */
+  std::vector<dup_group_t> groups;
+  KeyTable table;
+  QHash<QString, int32_t> names;
+  QHash<QString, int32_t> text_keys;
+
+  waypt_run_mutation_hook();
   for (Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
-
-    QString key;
+    dup_key_t key{0, -1};
     if (lcopt) {
-      /* The degrees2ddmm stuff is a feeble attempt to
-       * get everything rounded the same way in a precision
-       * that's "close enough" for determining duplicates.
-       */
-      key = QStringLiteral("%1%2")
-        .arg(degrees2ddmm(waypointp->latitude), 11, 'f', 3)
-        .arg(degrees2ddmm(waypointp->longitude), 11, 'f', 3);
+      double lat = degrees2ddmm(waypointp->latitude);
+      double lon = degrees2ddmm(waypointp->longitude);
+      int32_t lat_code;
+      int32_t lon_code;
+      if (quantize(lat, &lat_code) && quantize(lon, &lon_code)) {
+        key.coords = (static_cast<uint64_t>(static_cast<uint32_t>(lat_code)) << 32) |
+                     static_cast<uint32_t>(lon_code);
+      } else {
+        /* quantize never produces a code of -1, so these can't collide */
+        QString text = QStringLiteral("%1%2").arg(lat, 11, 'f', 3).arg(lon, 11, 'f', 3);
+        auto it = text_keys.constFind(text);
+        if (it == text_keys.cend()) {
+          it = text_keys.insert(text, static_cast<int32_t>(text_keys.size()));
+        }
+        auto id = static_cast<uint32_t>(*it);
+        key.coords = (static_cast<uint64_t>(id) << 32) | 0xffffffffULL;
+      }
     }
 
     if (snopt) {
-      key.append(waypointp->shortname);
+      auto it = names.constFind(waypointp->shortname);
+      if (it == names.cend()) {
+        it = names.insert(waypointp->shortname, static_cast<int32_t>(names.size()));
+      }
+      key.name = *it;
     }
 
-    wpthash.insert(key, waypointp);
+    int group = table.find_or_insert(key, groups, waypointp);
+    dup_group_t& g = groups[group];
+    if (g.first != waypointp) {
+      /* a duplicate of the first point with this key */
+      waypointp->wpt_flags.marked_for_deletion = 1;
+      if (purge_duplicates) {
+        g.first->wpt_flags.marked_for_deletion = 1;
+      }
+      g.last = waypointp;
+    }
   }
 
-  const QList<QString> keys = wpthash.uniqueKeys();
-  for (const auto& key : keys) {
-    const QList<Waypoint*> values = wpthash.values(key);
-    if (values.size() > 1) {
-      Waypoint* wptfirst = values.last(); // first inserted
-      if (correct_coords) {
-        Waypoint* wptlast = values.front(); // last inserted
-        wptfirst->latitude = wptlast->latitude;
-        wptfirst->longitude = wptlast->longitude;
-      }
-      for (auto it = values.cbegin(); it != values.cend(); ++it) {
-        Waypoint* wpt = *it;
-        if (purge_duplicates || (wpt != wptfirst)) {
-          wpt->wpt_flags.marked_for_deletion = 1;
-        }
-      }
+  if (correct_coords) {
+    for (const auto& g : groups) {
+      g.first->latitude = g.last->latitude;
+      g.first->longitude = g.last->longitude;
     }
   }
   del_marked_wpts();
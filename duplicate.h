@@ -22,6 +22,9 @@
 #ifndef DUPLICATE_H_INCLUDED_
 #define DUPLICATE_H_INCLUDED_
 
+#include <cstdint>   // for int32_t, uint64_t, INT32_MAX, INT32_MIN
+#include <vector>    // for vector
+
 #include <QString>   // for QString
 #include <QVector>   // for QVector
 
@@ -41,6 +44,50 @@ public:
   void process() override;
 
 private:
+  /* Types */
+
+  struct dup_key_t {
+    uint64_t coords;                  /* packed quantized latitude and longitude */
+    int32_t name;                     /* interned shortname, or -1 */
+
+    bool operator==(const dup_key_t& other) const
+    {
+      return (coords == other.coords) && (name == other.name);
+    }
+  };
+
+  struct dup_group_t {
+    dup_key_t key;
+    Waypoint* first;
+    Waypoint* last;
+  };
+
+  /* Open addressing (linear probing) from key to group index. */
+  class KeyTable
+  {
+  public:
+    int find_or_insert(const dup_key_t& key, std::vector<dup_group_t>& groups, Waypoint* wpt);
+
+  private:
+    static uint64_t hash(const dup_key_t& key);
+    void grow(const std::vector<dup_group_t>& groups);
+
+    std::vector<int32_t> slots_;
+  };
+
+  /* Constants */
+
+  static constexpr int32_t kNaNCode = 3;
+  static constexpr int32_t kPosInfCode = INT32_MAX;
+  static constexpr int32_t kNegInfCode = INT32_MIN + 1;
+  static constexpr double kMaxQuantizable = 1073741.0;
+
+  /* Member Functions */
+
+  static bool quantize(double x, int32_t* code);
+
+  /* Data Members */
+
   char* snopt = nullptr;
   char* lcopt = nullptr;
   char* purge_duplicates = nullptr;
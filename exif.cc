@@ -39,20 +39,25 @@
 #include <QByteArray>           // for QByteArray
 #include <QDate>                // for QDate
 #include <QDateTime>            // for QDateTime
+#include <QDir>                 // for QDir, QDir::Files, QDir::Name, QDir::Readable
+#include <QElapsedTimer>        // for QElapsedTimer
 #include <QFile>                // for QFile
-#include <QFileInfo>            // for QFileInfo
+#include <QFileInfo>            // for QFileInfo, QFileInfoList
 #include <QList>                // for QList
 #include <QPair>                // for QPair
 #include <QRegularExpression>   // for QRegularExpressionMatch, QRegularExpression
+#include <QSet>                 // for QSet
 #include <QString>              // for QString
+#include <QStringList>          // for QStringList
 #include <QTextCodec>           // for QTextCodec
+#include <QThreadPool>          // for QThreadPool
 #include <QTime>                // for QTime
 #include <QVariant>             // for QVariant
 #include <QVector>              // for QVector
 #include <Qt>                   // for UTC, ISODate
 #include <QtGlobal>             // for qPrintable, qint64
 
-#include <algorithm>            // for sort, min
+#include <algorithm>            // for sort, min, lower_bound
 #include <cassert>              // for assert
 #include <cctype>               // for isprint, isspace
 #include <cfloat>               // for DBL_EPSILON
@@ -62,6 +67,7 @@
 #include <cstdlib>              // for abs
 #include <cstring>              // for memcmp, strlen
 #include <utility>              // for as_const
+#include <vector>               // for vector
 
 #include "defs.h"               // for Waypoint, fatal, warning, global_options, global_opts, unknown_alt, xfree, route_disp_all, track_disp_all, waypt_disp_all, wp_flags, KNOTS_TO_MPS, KPH_TO_MPS, MPH_TO_MPS, MPS_TO_KPH, WAYPT_HAS, case_ignore_strcmp, waypt_add, xstrdup, xstrndup, fix_2d
 #include "garmin_tables.h"      // for gt_lookup_datum_index
@@ -1450,8 +1456,8 @@ ExifFormat::read()
   }
 }
 
-void
-ExifFormat::wr_init(const QString& fname)
+QString
+ExifFormat::exif_open_image(const QString& fname)
 {
   exif_success = 0;
   exif_fout_name = fname;
@@ -1459,34 +1465,61 @@ ExifFormat::wr_init(const QString& fname)
   exif_apps = new QList<ExifApp*>;
 
   fin_ = gbfopen_be(fname, "rb", MYNAME);
+  QString error;
   if (fin_->is_pipe) {
-    fatal(MYNAME ": Sorry, this format cannot be used with pipes!");
-  }
-
-  uint16_t soi = gbfgetuint16(fin_);
-  if (soi != 0xFFD8) {
-    fatal(MYNAME ": Unknown image file.");
-  }
-  exif_app_ = exif_load_apps();
-  if (exif_app_ == nullptr) {
-    fatal(MYNAME ": No EXIF header found in source file \"%s\".", fin_->name);
+    error = QStringLiteral("Sorry, this format cannot be used with pipes!");
+  } else if (gbfgetuint16(fin_) != 0xFFD8) {
+    error = QStringLiteral("Unknown image file.");
+  } else {
+    exif_app_ = exif_load_apps();
+    if (exif_app_ == nullptr) {
+      error = QStringLiteral("No EXIF header found in source file \"%1\".").arg(fin_->name);
+    } else {
+      exif_examine_app(exif_app_);
+      exif_time_ref = exif_get_exif_time(exif_app_);
+      if (!exif_time_ref.isValid()) {
+        error = QStringLiteral("No valid timestamp found in picture!\n");
+      }
+    }
   }
-  exif_examine_app(exif_app_);
   gbfclose(fin_);
+  fin_ = nullptr;
 
-  exif_time_ref = exif_get_exif_time(exif_app_);
-  if (!exif_time_ref.isValid()) {
-    fatal(MYNAME ": No valid timestamp found in picture!\n");
+  if (!error.isEmpty()) {
+    exif_release_apps();
+    exif_fout_name.clear();
+    return error;
   }
 
   QString filename(fname);
   filename += ".jpg";
   fout_ = gbfopen_be(filename, "wb", MYNAME);
+  return error;
+}
+
+void
+ExifFormat::wr_init(const QString& fname)
+{
+  exif_batch_dir.clear();
+  if (QFileInfo(fname).isDir()) {
+    /* Tag every image in the directory, see exif_write_batch */
+    exif_batch_dir = fname;
+    return;
+  }
+
+  QString error = exif_open_image(fname);
+  if (!error.isEmpty()) {
+    fatal(MYNAME ": %s", qPrintable(error));
+  }
 }
 
 void
 ExifFormat::wr_deinit()
 {
+  if (!exif_batch_dir.isEmpty()) {
+    exif_batch_dir.clear();
+    return;
+  }
 
   exif_release_apps();
   QString tmpname = QString(fout_->name);
@@ -1504,9 +1537,183 @@ ExifFormat::wr_deinit()
   exif_fout_name.clear();
 }
 
+/* Reject the best point if it is not within the time frame of the image. */
+void
+ExifFormat::exif_check_frame()
+{
+  qint64 frame = xstrtoi(opt_frame, nullptr, 10);
+
+  if (exif_wpt_ref == nullptr) {
+    warning(MYNAME ": No point with a valid timestamp found.\n");
+  } else if (std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)) > frame) {
+    QString time_str = exif_time_str(exif_time_ref);
+    warning(MYNAME ": No matching point found for image date %s!\n", qPrintable(time_str));
+    if (exif_wpt_ref != nullptr) {
+      QString str = exif_time_str(exif_wpt_ref->creation_time);
+      warning(MYNAME ": Best is from %s, %lld second(s) away.\n",
+              qPrintable(str), std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)));
+    }
+    exif_wpt_ref = nullptr;
+  }
+}
+
+/*
+ * Find the point closest in time to msecs in an index sorted by time and
+ * traversal order.  Ties are resolved like exif_find_wpt_by_time, i.e. the
+ * point seen first while traversing tracks, routes and waypoints wins.
+ */
+const Waypoint*
+ExifFormat::exif_find_wpt_in_index(const QVector<ExifTimeIndexEntry>& index, qint64 msecs)
+{
+  auto time_lt = [](const ExifTimeIndexEntry& entry, qint64 t)->bool {
+    return entry.msecs < t;
+  };
+
+  auto it = std::lower_bound(index.cbegin(), index.cend(), msecs, time_lt);
+  const ExifTimeIndexEntry* best = nullptr;
+  if (it != index.cend()) {
+    best = &*it;
+  }
+  if (it != index.cbegin()) {
+    /* first of the run of entries with the latest time before msecs */
+    auto prev = std::lower_bound(index.cbegin(), it, (it - 1)->msecs, time_lt);
+    if ((best == nullptr) ||
+        (msecs - prev->msecs < best->msecs - msecs) ||
+        ((msecs - prev->msecs == best->msecs - msecs) && (prev->seq < best->seq))) {
+      best = &*prev;
+    }
+  }
+  return (best == nullptr) ? nullptr : best->wpt;
+}
+
+/*
+ * Batch mode: the output is a directory and every jpeg image in it is tagged
+ * from the same input data.  The points are indexed by time once, and the
+ * images are rewritten in parallel, each by its own ExifFormat instance.
+ */
+void
+ExifFormat::exif_write_batch()
+{
+  QElapsedTimer total_timer;
+  total_timer.start();
+
+  const QFileInfoList entries = QDir(exif_batch_dir).entryInfoList(
+                                  {QStringLiteral("*.jpg"), QStringLiteral("*.jpeg")},
+                                  QDir::Files | QDir::Readable, QDir::Name);
+  QSet<QString> names;
+  for (const auto& entry : entries) {
+    names.insert(entry.fileName());
+  }
+  QStringList images;
+  for (const auto& entry : entries) {
+    /* skip the results of a previous run without overwrite */
+    const QString name = entry.fileName();
+    if (name.endsWith(u".jpg") && names.contains(name.chopped(4))) {
+      continue;
+    }
+    images.append(entry.filePath());
+  }
+
+  const Waypoint* name_wpt = nullptr;
+  QVector<ExifTimeIndexEntry> index;
+  if (opt_name) {
+    exif_wpt_ref = nullptr;
+    auto exif_find_wpt_by_name_lambda = [this](const Waypoint* waypointp)->void {
+      exif_find_wpt_by_name(waypointp);
+    };
+    waypt_disp_all(exif_find_wpt_by_name_lambda);
+    if (exif_wpt_ref == nullptr) {
+      route_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
+    }
+    if (exif_wpt_ref == nullptr) {
+      track_disp_all(nullptr, nullptr, exif_find_wpt_by_name_lambda);
+    }
+    if (exif_wpt_ref == nullptr) {
+      warning(MYNAME ": No matching point with name \"%s\" found.\n", opt_name);
+      return;
+    }
+    name_wpt = exif_wpt_ref;
+    exif_wpt_ref = nullptr;
+  } else {
+    auto exif_index_wpt_lambda = [&index](const Waypoint* waypointp)->void {
+      if (waypointp->creation_time.isValid()) {
+        index.append({waypointp->creation_time.toMSecsSinceEpoch(), static_cast<int>(index.size()), waypointp});
+      }
+    };
+    track_disp_all(nullptr, nullptr, exif_index_wpt_lambda);
+    route_disp_all(nullptr, nullptr, exif_index_wpt_lambda);
+    waypt_disp_all(exif_index_wpt_lambda);
+    std::sort(index.begin(), index.end(), [](const ExifTimeIndexEntry& a, const ExifTimeIndexEntry& b)->bool {
+      return (a.msecs < b.msecs) || ((a.msecs == b.msecs) && (a.seq < b.seq));
+    });
+  }
+
+  struct ExifBatchResult {
+    bool tagged{false};
+    qint64 elapsed{0};
+  };
+  std::vector<ExifBatchResult> results(images.size());
+
+  QThreadPool pool;
+  int threads = xstrtoi(opt_threads, nullptr, 10);
+  if (threads > 0) {
+    pool.setMaxThreadCount(threads);
+  }
+
+  for (int i = 0; i < images.size(); ++i) {
+    pool.start([this, &images, &results, &index, name_wpt, i]()->void {
+      QElapsedTimer timer;
+      timer.start();
+
+      ExifFormat worker;
+      worker.opt_overwrite = opt_overwrite;
+      worker.opt_frame = opt_frame;
+      worker.opt_name = opt_name;
+      worker.opt_offsettime = opt_offsettime;
+
+      QString error = worker.exif_open_image(images.at(i));
+      if (!error.isEmpty()) {
+        warning(MYNAME ": Skipping \"%s\": %s\n", qPrintable(images.at(i)), qPrintable(error.trimmed()));
+      } else {
+        if (name_wpt != nullptr) {
+          worker.exif_wpt_ref = name_wpt;
+        } else {
+          worker.exif_wpt_ref = exif_find_wpt_in_index(index, worker.exif_time_ref.toMSecsSinceEpoch());
+          worker.exif_check_frame();
+        }
+        worker.exif_write_gps();
+        results[i].tagged = worker.exif_success;
+        worker.wr_deinit();
+      }
+      results[i].elapsed = timer.elapsed();
+    });
+  }
+  pool.waitForDone();
+
+  int tagged = 0;
+  for (int i = 0; i < images.size(); ++i) {
+    if (results.at(i).tagged) {
+      ++tagged;
+    }
+    if (global_opts.debug_level >= 1) {
+      printf(MYNAME ": %s: %s in %lld ms\n", qPrintable(images.at(i)),
+             results.at(i).tagged ? "tagged" : "not tagged", results.at(i).elapsed);
+    }
+  }
+  if (global_opts.debug_level >= 1) {
+    printf(MYNAME ": tagged %d of %d image(s) in %lld ms using %d thread(s)\n",
+           tagged, static_cast<int>(images.size()), total_timer.elapsed(), pool.maxThreadCount());
+  }
+}
+
 void
 ExifFormat::write()
 {
+  if (!exif_batch_dir.isEmpty()) {
+    exif_write_batch();
+    return;
+  }
+
   exif_wpt_ref = nullptr;
 
   if (opt_name) {
@@ -1531,22 +1738,15 @@ ExifFormat::write()
     route_disp_all(nullptr, nullptr, exif_find_wpt_by_time_lambda);
     waypt_disp_all(exif_find_wpt_by_time_lambda);
 
-    qint64 frame = xstrtoi(opt_frame, nullptr, 10);
-
-    if (exif_wpt_ref == nullptr) {
-      warning(MYNAME ": No point with a valid timestamp found.\n");
-    } else if (std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)) > frame) {
-      QString time_str = exif_time_str(exif_time_ref);
-      warning(MYNAME ": No matching point found for image date %s!\n", qPrintable(time_str));
-      if (exif_wpt_ref != nullptr) {
-        QString str = exif_time_str(exif_wpt_ref->creation_time);
-        warning(MYNAME ": Best is from %s, %lld second(s) away.\n",
-                qPrintable(str), std::abs(exif_time_ref.secsTo(exif_wpt_ref->creation_time)));
-      }
-      exif_wpt_ref = nullptr;
-    }
+    exif_check_frame();
   }
 
+  exif_write_gps();
+}
+
+void
+ExifFormat::exif_write_gps()
+{
   if (exif_wpt_ref != nullptr) {
     const Waypoint* wpt = exif_wpt_ref;
 
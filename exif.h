@@ -43,6 +43,7 @@
 #include <QTime>      // for QTime
 #include <QVariant>   // for QVariant
 #include <QVector>    // for QVector
+#include <QtGlobal>   // for qint64
 
 #include <cstdint>    // for uint32_t, uint16_t, uint8_t, int16_t, int32_t
 
@@ -136,6 +137,12 @@ private:
     QList<ExifIfd> ifds;
   };
 
+  struct ExifTimeIndexEntry {
+    qint64 msecs;             // creation time in ms since the epoch
+    int seq;                  // traversal order, tracks then routes then waypoints
+    const Waypoint* wpt;
+  };
+
   template <class T>
   class Rational
   {
@@ -183,12 +190,17 @@ private:
   void exif_put_short(int ifd_nr, int tag_id, int index, int16_t val) const;
   void exif_remove_tag(int ifd_nr, int tag_id) const;
   void exif_find_wpt_by_time(const Waypoint* wpt);
+  static const Waypoint* exif_find_wpt_in_index(const QVector<ExifTimeIndexEntry>& index, qint64 msecs);
   void exif_find_wpt_by_name(const Waypoint* wpt);
   static bool exif_sort_tags_cb(const ExifTag& A, const ExifTag& B);
   static bool exif_sort_ifds_cb(const ExifIfd& A, const ExifIfd& B);
   static void exif_write_value(ExifTag* tag, gbfile* fout);
   static void exif_write_ifd(ExifIfd* ifd, char next, gbfile* fout);
   void exif_write_apps() const;
+  QString exif_open_image(const QString& fname);
+  void exif_check_frame();
+  void exif_write_gps();
+  void exif_write_batch();
 
   /* Data Members */
 
@@ -200,12 +212,14 @@ private:
   QDateTime exif_time_ref;
   char exif_success{};
   QString exif_fout_name;
+  QString exif_batch_dir;
 
   char* opt_filename{};
   char* opt_overwrite{};
   char* opt_frame{};
   char* opt_name{};
   char* opt_offsettime{};
+  char* opt_threads{};
 
   QVector<arglist_t> exif_args = {
     { "filename", &opt_filename, "Set waypoint name to source filename", "Y", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
@@ -213,6 +227,7 @@ private:
     { "name", &opt_name, "Locate waypoint for tagging by this name", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
     { "overwrite", &opt_overwrite, "!OVERWRITE! the original file. Default=N", "N", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
     { "offset", &opt_offsettime, "Image Offset Time (+HH:MM or -HH:MM)", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
+    { "threads", &opt_threads, "Worker threads when tagging a directory (0 = auto)", "0", ARGTYPE_INT, "0", nullptr, nullptr },
   };
 };
 #endif // EXIF_H_INCLUDED_
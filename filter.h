@@ -23,7 +23,8 @@
 #include "defs.h"
 
 // Filter have access to the global_waypoint_list, which formats really
-// shouldn't have.
+// shouldn't have.  Filters that change it directly must call
+// waypt_run_mutation_hook() first.
 extern WaypointList* global_waypoint_list;
 
 class Filter
@@ -22,12 +22,14 @@
 
 #include <cstdint>               // for int32_t
 #include <cstring>               // for strncpy, strchr, strlen, strncmp
+#include <optional>              // for optional
 #include <QChar>                 // for operator==, QChar
 #include <QDebug>                // for QDebug
 #include <Qt>                    // for CaseInsensitive
 #include "defs.h"
 #include "garmin_tables.h"
 #include "jeeps/gpsmath.h"       // for GPS_Lookup_Datum_Index, GPS_Math_Get_Datum_Name
+#include "jeeps/gpsnames.h"      // for GPS_Name_Lookup
 #include "src/core/logging.h"    // for Fatal
 
 #define MYNAME "garmin_tables"
@@ -643,11 +645,17 @@ gt_get_icao_cc(const QString& country, const QString& shortname)
 grid_type
 gt_lookup_grid_type(const char* grid_name, const QString& module)
 {
-  for (const grid_mapping_t* g = gt_mps_grid_names; (g->shortname); g++) {
-    if (QString::compare(grid_name, g->shortname, Qt::CaseInsensitive) == 0 ||
-        QString::compare(grid_name, g->longname,Qt::CaseInsensitive) == 0) {
-      return g->grid;
+  static const GPS_Name_Lookup<grid_type> grids = []() {
+    GPS_Name_Lookup<grid_type> table;
+    for (const grid_mapping_t* g = gt_mps_grid_names; (g->shortname); g++) {
+      table.add(g->shortname, g->grid);
+      table.add(g->longname, g->grid);
     }
+    return table;
+  }();
+
+  if (std::optional<grid_type> grid = grids.find(grid_name); grid.has_value()) {
+    return *grid;
   }
 
   fatal(FatalMsg() << module << ": Unsupported grid (" << grid_name <<
@@ -682,14 +690,15 @@ gt_get_mps_datum_name(const int datum_index)
 int
 gt_lookup_datum_index(const char* datum_str, const QString& module)
 {
-  const char* name = datum_str;
-
-  for (const datum_mapping_t* d = gt_mps_datum_names; (d->jeeps_name); d++) {
-    if (QString::compare(name, d->mps_name, Qt::CaseInsensitive) == 0) {
-      name = d->jeeps_name;
-      break;
+  static const GPS_Name_Lookup<const char*> mps_datums = []() {
+    GPS_Name_Lookup<const char*> table;
+    for (const datum_mapping_t* d = gt_mps_datum_names; (d->jeeps_name); d++) {
+      table.add(d->mps_name, d->jeeps_name);
     }
-  }
+    return table;
+  }();
+
+  const char* name = mps_datums.find(datum_str).value_or(datum_str);
 
   int result = GPS_Lookup_Datum_Index(name);
 
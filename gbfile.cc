@@ -24,7 +24,7 @@
 #include <QChar>               // for QChar, operator==, operator!=
 #include <QDebug>              // for QDebug
 #include <QString>             // for QString
-#include <QtGlobal>            // for qPrintable
+#include <QtGlobal>            // for qPrintable, qint64
 
 #include <cassert>             // for assert
 #include <cctype>              // for tolower
@@ -35,6 +35,7 @@
 #include "defs.h"
 #include "gbfile.h"
 #include "src/core/logging.h"
+#include "src/core/perfstats.h"  // for PerfStats
 
 #if __WIN32__
 /* taken from minigzip.c (part of the zlib project) */
@@ -691,7 +692,9 @@ gbfread(void* buf, const gbsize_t size, const gbsize_t members, gbfile* file)
   if ((size == 0) || (members == 0)) {
     return 0;
   }
-  return file->fileread(buf, size, members, file);
+  gbsize_t result = file->fileread(buf, size, members, file);
+  gpsbabel::PerfStats::count_read(static_cast<qint64>(result) * size);
+  return result;
 }
 // This probably makes an unnecessary alloc/copy, but keeps the above (kinda
 
@@ -813,6 +816,7 @@ int
 gbfwrite(const void* buf, const gbsize_t size, const gbsize_t members, gbfile* file)
 {
   unsigned int result = file->filewrite(buf, size, members, file);
+  gpsbabel::PerfStats::count_written(static_cast<qint64>(result) * size);
   if (result != members) {
     fatal("%s: Could not write %lld bytes to %s (result %d)!\n",
           file->module,
@@ -120,23 +120,162 @@ double heading_true_degrees(double lat1, double lon1, double lat2, double lon2)
   return h;
 }
 
+/*
+ * The batched functions use the same operations in the same order as the
+ * scalar ones, so the results are bit for bit identical.  The trig of
+ * each latitude is computed once per point instead of once per pair, and
+ * work is split into short loops over blocks of points so the arithmetic
+ * between the libm calls can be vectorized.  Where the compiler supports
+ * it an AVX2 build of each is chosen at load time on cpus that have it.
+ */
+#if defined(__x86_64__) && defined(__linux__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define GRTCIRC_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef GRTCIRC_CLONES
+#define GRTCIRC_CLONES
+#endif
+
+static constexpr int kBatch = 64;
+
+/* finish gcdist from the half angle sines and the cosine product, in place */
+static inline void gcdist_finish(const double* sdlat, const double* sdlon,
+                                 const double* coscos, int m, double* dist)
+{
+  for (int i = 0; i < m; ++i) {
+    double res = sqrt(sdlat[i] * sdlat[i] + coscos[i] * sdlon[i] * sdlon[i]);
+    if (res > 1.0) {
+      res = 1.0;
+    } else if (res < -1.0) {
+      res = -1.0;
+    }
+    dist[i] = res;
+  }
+  for (int i = 0; i < m; ++i) {
+    double res = asin(dist[i]);
+    dist[i] = std::isnan(res) ? 0.0 : 2.0 * res;
+  }
+}
+
+GRTCIRC_CLONES
+void gcdist_path(const double* lat, const double* lon, int n, double* dist)
+{
+  double coslat[kBatch + 1];
+  double coscos[kBatch];
+  double sdlat[kBatch];
+  double sdlon[kBatch];
+
+  for (int base = 0; base + 1 < n; base += kBatch) {
+    const int m = std::min(kBatch, n - 1 - base);
+    const double* la = lat + base;
+    const double* lo = lon + base;
+    for (int i = 0; i <= m; ++i) {
+      coslat[i] = cos(la[i]);
+    }
+    for (int i = 0; i < m; ++i) {
+      coscos[i] = coslat[i] * coslat[i + 1];
+      sdlat[i] = (la[i] - la[i + 1]) / 2.0;
+      sdlon[i] = (lo[i] - lo[i + 1]) / 2.0;
+    }
+    for (int i = 0; i < m; ++i) {
+      sdlat[i] = sin(sdlat[i]);
+      sdlon[i] = sin(sdlon[i]);
+    }
+    gcdist_finish(sdlat, sdlon, coscos, m, dist + base);
+  }
+}
+
+GRTCIRC_CLONES
+void gcdist_from(double lat0, double lon0, const double* lat, const double* lon, int n, double* dist)
+{
+  const double coslat0 = cos(lat0);
+  double coscos[kBatch];
+  double sdlat[kBatch];
+  double sdlon[kBatch];
+
+  for (int base = 0; base < n; base += kBatch) {
+    const int m = std::min(kBatch, n - base);
+    const double* la = lat + base;
+    const double* lo = lon + base;
+    for (int i = 0; i < m; ++i) {
+      coscos[i] = cos(la[i]);
+    }
+    for (int i = 0; i < m; ++i) {
+      coscos[i] = coslat0 * coscos[i];
+      sdlat[i] = (lat0 - la[i]) / 2.0;
+      sdlon[i] = (lon0 - lo[i]) / 2.0;
+    }
+    for (int i = 0; i < m; ++i) {
+      sdlat[i] = sin(sdlat[i]);
+      sdlon[i] = sin(sdlon[i]);
+    }
+    gcdist_finish(sdlat, sdlon, coscos, m, dist + base);
+  }
+}
+
+GRTCIRC_CLONES
+void heading_true_degrees_path(const double* lat, const double* lon, int n, double* hdg)
+{
+  double sinlat[kBatch + 1];
+  double coslat[kBatch + 1];
+  double sindlon[kBatch];
+  double cosdlon[kBatch];
+
+  for (int base = 0; base + 1 < n; base += kBatch) {
+    const int m = std::min(kBatch, n - 1 - base);
+    const double* la = lat + base;
+    const double* lo = lon + base;
+    for (int i = 0; i <= m; ++i) {
+      sinlat[i] = sin(la[i]);
+      coslat[i] = cos(la[i]);
+    }
+    for (int i = 0; i < m; ++i) {
+      const double dlon = lo[i] - lo[i + 1];
+      sindlon[i] = sin(dlon);
+      cosdlon[i] = cos(dlon);
+    }
+    for (int i = 0; i < m; ++i) {
+      /* as heading() */
+      double v1 = sindlon[i] * coslat[i + 1];
+      double v2 = coslat[i] * sinlat[i + 1] - sinlat[i] * coslat[i + 1] * cosdlon[i];
+      if (fabs(v1) < 1e-15) {
+        v1 = 0.0;
+      }
+      if (fabs(v2) < 1e-15) {
+        v2 = 0.0;
+      }
+      hdg[base + i] = atan2(v1, v2);
+    }
+    for (int i = 0; i < m; ++i) {
+      /* as heading_true_degrees() */
+      double h = 360.0 - DEG(hdg[base + i]);
+      if (h >= 360.0) {
+        h -= 360.0;
+      }
+      hdg[base + i] = h;
+    }
+  }
+}
+
 // Note: This is probably not going to vectorize as it uses statics internally,
 // so it's hard for the optimizer to prove it's a pure function with no side
 // effects, right?
+// The cached segment is per thread so filters may call this concurrently.
 double linedistprj(double lat1, double lon1,
                    double lat2, double lon2,
                    double lat3, double lon3,
                    double* prjlat, double* prjlon,
                    double* frac)
 {
-  static double _lat1 = -9999;
-  static double _lat2 = -9999;
-  static double _lon1 = -9999;
-  static double _lon2 = -9999;
-
-  static double x1, y1, z1;
-  static double x2, y2, z2;
-  static double xa, ya, za, la;
+  static thread_local double _lat1 = -9999;
+  static thread_local double _lat2 = -9999;
+  static thread_local double _lon1 = -9999;
+  static thread_local double _lon2 = -9999;
+
+  static thread_local double x1, y1, z1;
+  static thread_local double x2, y2, z2;
+  static thread_local double xa, ya, za, la;
 
   double dot;
 
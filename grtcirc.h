@@ -36,6 +36,17 @@ double linedist(double lat1, double lon1,
                 double lat2, double lon2,
                 double lat3, double lon3);
 
+/*
+ * Batched forms for runs of points, inputs in radians.  They return the
+ * same values as calling the scalar functions for each pair.
+ *   gcdist_path:               dist[i] = gcdist(point i, point i+1), i < n-1
+ *   gcdist_from:               dist[i] = gcdist(lat0/lon0, point i), i < n
+ *   heading_true_degrees_path: hdg[i] = heading_true_degrees(point i, point i+1), i < n-1
+ */
+void gcdist_path(const double* lat, const double* lon, int n, double* dist);
+void gcdist_from(double lat0, double lon0, const double* lat, const double* lon, int n, double* dist);
+void heading_true_degrees_path(const double* lat, const double* lon, int n, double* hdg);
+
 double radtometers(double rads);
 double radtomiles(double rads);
 
@@ -24,9 +24,20 @@
 
 #include "defs.h"
 #include "height.h"
-#include <cmath>    // for floor
-#include <cstdint>  // for int8_t
-#include <cstdlib>  // for strtod
+#include <algorithm>  // for min, sort
+#include <cmath>      // for fabs, floor, lround, sqrt
+#include <cstdint>    // for int8_t
+#include <cstdlib>    // for abs, strtod
+#include <utility>    // for move, pair
+#include <vector>     // for vector
+
+#include <QByteArray> // for QByteArray
+#include <QChar>      // for QChar
+#include <QDir>       // for QDir
+#include <QIODevice>  // for QIODevice, QIODevice::ReadOnly
+#include <QList>      // for QList
+#include <QtEndian>   // for qFromBigEndian
+#include <QtGlobal>   // for qint16, qint64, quint16, uchar
 
 #define MYNAME "height"
 
@@ -79,19 +90,315 @@ double HeightFilter::wgs84_separation(double lat, double lon)
          );
 }
 
-void HeightFilter::correct_height(const Waypoint* wpt)
+/* Tiles are numbered by the integer degrees of their south west corner. */
+int HeightFilter::DemTileCache::tile_key(double lat, double lon)
 {
-  auto* waypointp = const_cast<Waypoint*>(wpt);
+  if (!(fabs(lat) <= 90.0) || !(fabs(lon) <= 180.0)) {
+    return -1;
+  }
+  if (lon >= 180.0) {
+    lon -= 360.0;
+  }
+  auto ilat = static_cast<int>(floor(lat));
+  auto ilon = static_cast<int>(floor(lon));
+  return (ilat + 90) * 360 + (ilon + 180);
+}
 
-  if (waypointp->altitude != unknown_alt) {
-    if (addopt != nullptr) {
-      waypointp->altitude += addf;
+bool HeightFilter::DemTileCache::load(int ilat, int ilon, tile_t* tile) const
+{
+  const QString name = QStringLiteral("%1%2%3%4.hgt")
+                       .arg(QChar((ilat < 0) ? 'S' : 'N'))
+                       .arg(std::abs(ilat), 2, 10, QChar('0'))
+                       .arg(QChar((ilon < 0) ? 'W' : 'E'))
+                       .arg(std::abs(ilon), 3, 10, QChar('0'));
+  const QDir dir(dir_);
+  auto file = std::make_unique<QFile>(dir.filePath(name));
+  if (!file->exists()) {
+    file->setFileName(dir.filePath(name.toLower()));
+    if (!file->exists()) {
+      return false;
+    }
+  }
+  if (!file->open(QIODevice::ReadOnly)) {
+    fatal(MYNAME ": Cannot open DEM tile \"%s\": %s\n",
+          qPrintable(file->fileName()), qPrintable(file->errorString()));
+  }
+
+  /* The tile is square, 1201 samples for 3" data and 3601 for 1". */
+  const qint64 size = file->size();
+  const auto samples = static_cast<int>(lround(sqrt(size / 2.0)));
+  if ((samples < 2) || (2LL * samples * samples != size)) {
+    fatal(MYNAME ": DEM tile \"%s\" is not a square grid of 16 bit samples.\n",
+          qPrintable(file->fileName()));
+  }
+
+  tile->samples = samples;
+  tile->data = file->map(0, size);
+  if (tile->data == nullptr) {
+    tile->contents = file->readAll();
+    if (tile->contents.size() != size) {
+      fatal(MYNAME ": Cannot read DEM tile \"%s\".\n", qPrintable(file->fileName()));
     }
+    tile->data = reinterpret_cast<const uchar*>(tile->contents.constData());
+    file->close();
+  }
+  tile->file = std::move(file);
+  return true;
+}
+
+const HeightFilter::DemTileCache::tile_t* HeightFilter::DemTileCache::find(int ilat, int ilon)
+{
+  const int key = (ilat + 90) * 360 + (ilon + 180);
+  auto it = index_.constFind(key);
+  if (it != index_.constEnd()) {
+    lru_.splice(lru_.begin(), lru_, it.value());
+    return &lru_.front();
+  }
+  if (missing_.contains(key)) {
+    return nullptr;
+  }
 
+  tile_t tile;
+  tile.key = key;
+  if (!load(ilat, ilon, &tile)) {
+    missing_.insert(key);
+    return nullptr;
+  }
+  if (static_cast<int>(lru_.size()) >= capacity_) {
+    index_.remove(lru_.back().key);
+    lru_.pop_back();
+  }
+  lru_.push_front(std::move(tile));
+  index_.insert(key, lru_.begin());
+  return &lru_.front();
+}
+
+/*
+ * Bilinear interpolation between the four samples around the point.
+ * Void samples are left out and the weights of the others rescaled.
+ */
+std::optional<double> HeightFilter::DemTileCache::height(double lat, double lon)
+{
+  if (!((lat >= -90.0) && (lat < 90.0) && (lon >= -180.0) && (lon <= 180.0))) {
+    return std::nullopt;
+  }
+  if (lon >= 180.0) {
+    lon -= 360.0;
+  }
+  const auto ilat = static_cast<int>(floor(lat));
+  const auto ilon = static_cast<int>(floor(lon));
+  const tile_t* tile = find(ilat, ilon);
+  if (tile == nullptr) {
+    return std::nullopt;
+  }
+
+  /* rows run from north to south, columns from west to east. */
+  const int last = tile->samples - 1;
+  const double y = (ilat + 1 - lat) * last;
+  const double x = (lon - ilon) * last;
+  const int r0 = std::min(static_cast<int>(y), last);
+  const int c0 = std::min(static_cast<int>(x), last);
+  const int r1 = std::min(r0 + 1, last);
+  const int c1 = std::min(c0 + 1, last);
+  const double fy = y - r0;
+  const double fx = x - c0;
+
+  const int rows[4] = {r0, r0, r1, r1};
+  const int cols[4] = {c0, c1, c0, c1};
+  const double weights[4] = {(1.0 - fy) * (1.0 - fx), (1.0 - fy) * fx, fy * (1.0 - fx), fy * fx};
+  double sum = 0.0;
+  double weight = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    const auto z = qFromBigEndian<qint16>(tile->data + 2 * (rows[i] * tile->samples + cols[i]));
+    if (z != kVoid) {
+      sum += weights[i] * z;
+      weight += weights[i];
+    }
+  }
+  if (weight <= 0.0) {
+    return std::nullopt;
+  }
+  return sum / weight;
+}
+
+HeightFilter::GeoidGrid::GeoidGrid(const QString& fname) :
+  file_(std::make_unique<QFile>(fname))
+{
+  if (!file_->open(QIODevice::ReadOnly)) {
+    fatal(MYNAME ": Cannot open geoid grid \"%s\": %s\n",
+          qPrintable(fname), qPrintable(file_->errorString()));
+  }
+  if (file_->readLine().trimmed() != "P5") {
+    fatal(MYNAME ": Geoid grid \"%s\" is not a binary PGM file.\n", qPrintable(fname));
+  }
+
+  /* Width, height and maximum value, with comments carrying the scaling. */
+  QList<int> numbers;
+  bool have_offset = false;
+  bool have_scale = false;
+  while (numbers.size() < 3) {
+    if (file_->atEnd()) {
+      fatal(MYNAME ": Geoid grid \"%s\" has an incomplete header.\n", qPrintable(fname));
+    }
+    const QByteArray line = file_->readLine().simplified();
+    if (line.startsWith('#')) {
+      const QList<QByteArray> words = line.mid(1).simplified().split(' ');
+      if (words.size() >= 2 && words.at(0) == "Offset") {
+        offset_ = words.at(1).toDouble(&have_offset);
+      } else if (words.size() >= 2 && words.at(0) == "Scale") {
+        scale_ = words.at(1).toDouble(&have_scale);
+      }
+      continue;
+    }
+    for (const auto& word : line.split(' ')) {
+      bool ok;
+      numbers.append(word.toInt(&ok));
+      if (!ok) {
+        fatal(MYNAME ": Geoid grid \"%s\" has an invalid header.\n", qPrintable(fname));
+      }
+    }
+  }
+  width_ = numbers.at(0);
+  height_ = numbers.at(1);
+  if (!have_offset || !have_scale || (numbers.at(2) != 65535) ||
+      (height_ < 2) || ((height_ - 1) % 180 != 0) || (width_ != 2 * (height_ - 1))) {
+    fatal(MYNAME ": Geoid grid \"%s\" is not a global grid with 16 bit samples, offset and scale.\n",
+          qPrintable(fname));
+  }
+  per_degree_ = (height_ - 1) / 180.0;
+
+  const qint64 offset = file_->pos();
+  const qint64 size = 2LL * width_ * height_;
+  if (file_->size() - offset < size) {
+    fatal(MYNAME ": Geoid grid \"%s\" is truncated.\n", qPrintable(fname));
+  }
+  data_ = file_->map(offset, size);
+  if (data_ == nullptr) {
+    contents_ = file_->read(size);
+    if (contents_.size() != size) {
+      fatal(MYNAME ": Cannot read geoid grid \"%s\".\n", qPrintable(fname));
+    }
+    data_ = reinterpret_cast<const uchar*>(contents_.constData());
+    file_->close();
+  }
+}
+
+/* Bilinear interpolation, wrapping around in longitude. */
+void HeightFilter::GeoidGrid::separation(int n, const double* lat, const double* lon, double* sep) const
+{
+  auto sample = [this](int row, int col)->double {
+    return qFromBigEndian<quint16>(data_ + 2 * (static_cast<qint64>(row) * width_ + col));
+  };
+
+  for (int i = 0; i < n; ++i) {
+    /* sanity checks to prevent segfault on bad data */
+    if ((lat[i] > 90.0) || (lat[i] < -90.0)) {
+      fatal(MYNAME ": Invalid latitude value (%f)\n", lat[i]);
+    }
+    if ((lon[i] > 180.0) || (lon[i] < -180.0)) {
+      fatal(MYNAME ": Invalid longitude value (%f)\n", lon[i]);
+    }
+
+    const double y = (90.0 - lat[i]) * per_degree_;
+    double x = lon[i] * per_degree_;
+    if (x < 0.0) {
+      x += width_;
+    }
+    const int r0 = std::min(static_cast<int>(y), height_ - 1);
+    const int r1 = std::min(r0 + 1, height_ - 1);
+    const double fx = x - floor(x);
+    const int c0 = static_cast<int>(floor(x)) % width_;
+    const int c1 = (c0 + 1) % width_;
+    const double fy = y - r0;
+
+    const double v = (1.0 - fy) * ((1.0 - fx) * sample(r0, c0) + fx * sample(r0, c1)) +
+                     fy * ((1.0 - fx) * sample(r1, c0) + fx * sample(r1, c1));
+    sep[i] = offset_ + scale_ * v;
+  }
+}
+
+/* geoid separations of n points, from the loaded grid or the built in one */
+void HeightFilter::wgs84_separation(int n, const double* lat, const double* lon, double* sep) const
+{
+  if (geoid_grid) {
+    geoid_grid->separation(n, lat, lon, sep);
+  } else {
+    for (int i = 0; i < n; ++i) {
+      sep[i] = wgs84_separation(lat[i], lon[i]);
+    }
+  }
+}
+
+/*
+ * Apply add and wgs84tomsl to the points that have an altitude.  The
+ * geoid separations are evaluated a batch of points at a time.
+ */
+void HeightFilter::correct_heights(const std::vector<Waypoint*>& points) const
+{
+  Waypoint* batch[kSeparationBatch];
+  double lat[kSeparationBatch];
+  double lon[kSeparationBatch];
+  double sep[kSeparationBatch];
+  int count = 0;
+
+  auto flush_batch = [&]()->void {
+    wgs84_separation(count, lat, lon, sep);
+    for (int i = 0; i < count; ++i) {
+      batch[i]->altitude -= sep[i];
+    }
+    count = 0;
+  };
+
+  for (Waypoint* wpt : points) {
+    if (wpt->altitude == unknown_alt) {
+      continue;
+    }
+    if (addopt != nullptr) {
+      wpt->altitude += addf;
+    }
     if (wgs84tomslopt != nullptr) {
-      waypointp->altitude -= wgs84_separation(waypointp->latitude, waypointp->longitude);
+      batch[count] = wpt;
+      lat[count] = wpt->latitude;
+      lon[count] = wpt->longitude;
+      if (++count == kSeparationBatch) {
+        flush_batch();
+      }
     }
   }
+  if (count > 0) {
+    flush_batch();
+  }
+}
+
+/*
+ * Take altitudes from the DEM, visiting the points tile by tile so each
+ * tile is mapped once.  The points the DEM doesn't provide an altitude
+ * for are left in points, for the other corrections.
+ */
+void HeightFilter::dem_height(DemTileCache& dem, std::vector<Waypoint*>& points) const
+{
+  std::vector<std::pair<int, Waypoint*>> keyed;
+  keyed.reserve(points.size());
+  for (Waypoint* wpt : points) {
+    keyed.emplace_back(DemTileCache::tile_key(wpt->latitude, wpt->longitude), wpt);
+  }
+
+  std::sort(keyed.begin(), keyed.end(),
+  [](const std::pair<int, Waypoint*>& a, const std::pair<int, Waypoint*>& b)->bool {
+    return a.first < b.first;
+  });
+
+  points.clear();
+  for (const auto& [key, wpt] : keyed) {
+    if ((demfillopt == nullptr) || (wpt->altitude == unknown_alt)) {
+      std::optional<double> height = dem.height(wpt->latitude, wpt->longitude);
+      if (height.has_value()) {
+        wpt->altitude = *height;
+        continue;
+      }
+    }
+    points.push_back(wpt);
+  }
 }
 
 void HeightFilter::init()
@@ -109,15 +416,35 @@ void HeightFilter::init()
   } else {
     addf = 0.0;
   }
+
+  if (geoidopt != nullptr) {
+    if (wgs84tomslopt == nullptr) {
+      fatal(MYNAME ": The geoid option requires the wgs84tomsl option.\n");
+    }
+    geoid_grid = std::make_unique<GeoidGrid>(geoidopt);
+  }
 }
 
 void HeightFilter::process()
 {
-  WayptFunctor<HeightFilter> correct_height_f(this, &HeightFilter::correct_height);
+  std::vector<Waypoint*> points;
+  auto collect_lambda = [&points](const Waypoint* wpt)->void {
+    points.push_back(const_cast<Waypoint*>(wpt));
+  };
+  waypt_disp_all(collect_lambda);
+  route_disp_all(nullptr, nullptr, collect_lambda);
+  track_disp_all(nullptr, nullptr, collect_lambda);
 
-  waypt_disp_all(correct_height_f);
-  route_disp_all(nullptr, nullptr, correct_height_f);
-  track_disp_all(nullptr, nullptr, correct_height_f);
+  if (demopt != nullptr) {
+    DemTileCache dem(demopt, xstrtoi(demcacheopt, nullptr, 10));
+    dem_height(dem, points);
+  }
+  correct_heights(points);
+}
+
+void HeightFilter::deinit()
+{
+  geoid_grid.reset();
 }
 
 #endif // FILTERS_ENABLED
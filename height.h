@@ -25,10 +25,19 @@
 #define HEIGHT_H_INCLUDED_
 
 #include <cstdint>         // for int8_t in heightgrid.h
-
+#include <list>            // for list
+#include <memory>          // for unique_ptr
+#include <optional>        // for optional
+#include <vector>          // for vector
+
+#include <QByteArray>      // for QByteArray
+#include <QFile>           // for QFile
+#include <QHash>           // for QHash
+#include <QSet>            // for QSet
+#include <QString>         // for QString
 #include <QVector>         // for QVector
 
-#include "defs.h"          // for arglist_t, ARG_NOMINMAX, ARGTYPE_BEGIN_REQ, ARGTYPE_BOOL, ARGTYPE_END_REQ, ARGTYPE_FLOAT, Waypoint
+#include "defs.h"          // for arglist_t, ARG_NOMINMAX, ARGTYPE_BEGIN_REQ, ARGTYPE_BOOL, ARGTYPE_END_REQ, ARGTYPE_FILE, ARGTYPE_FLOAT, ARGTYPE_INT, ARGTYPE_STRING, Waypoint
 #include "filter.h"        // for Filter
 
 #if FILTERS_ENABLED
@@ -42,11 +51,84 @@ public:
   }
   void init() override;
   void process() override;
+  void deinit() override;
 
 private:
+  /* Types */
+
+  /*
+   * Elevation from SRTM style .hgt tiles in a directory: one degree
+   * squares of big endian 16 bit heights, named after their south west
+   * corner (e.g. N45W122.hgt).  Tiles are memory mapped on first use and
+   * the least recently used ones are released beyond the capacity.
+   */
+  class DemTileCache
+  {
+  public:
+    DemTileCache(const QString& dir, int capacity) : dir_(dir), capacity_(capacity) {}
+
+    std::optional<double> height(double lat, double lon);
+    static int tile_key(double lat, double lon);
+
+  private:
+    struct tile_t {
+      int key{0};
+      int samples{0};                  /* per row and per column */
+      std::unique_ptr<QFile> file;
+      QByteArray contents;             /* only if the file can't be mapped */
+      const uchar* data{nullptr};
+    };
+
+    static constexpr qint16 kVoid = -32768;
+
+    const tile_t* find(int ilat, int ilon);
+    bool load(int ilat, int ilon, tile_t* tile) const;
+
+    QString dir_;
+    int capacity_;
+    std::list<tile_t> lru_;            /* most recently used first */
+    QHash<int, std::list<tile_t>::iterator> index_;
+    QSet<int> missing_;
+  };
+
+  /*
+   * A global geoid grid in the PGM format used by GeographicLib, e.g.
+   * egm2008-2_5.pgm: big endian 16 bit samples, scaled by the Offset and
+   * Scale given in the header, in rows from 90N southwards and columns
+   * from 0E eastwards.  The samples are memory mapped.
+   */
+  class GeoidGrid
+  {
+  public:
+    explicit GeoidGrid(const QString& fname);
+
+    void separation(int n, const double* lat, const double* lon, double* sep) const;
+
+  private:
+    std::unique_ptr<QFile> file_;
+    QByteArray contents_;              /* only if the file can't be mapped */
+    const uchar* data_{nullptr};
+    int width_{0};
+    int height_{0};
+    double per_degree_{0.0};
+    double offset_{0.0};
+    double scale_{0.0};
+  };
+
+  /* Constants */
+
+  static constexpr int kSeparationBatch = 256;
+
+  /* Data Members */
+
   char* addopt        = nullptr;
   char* wgs84tomslopt = nullptr;
+  char* geoidopt      = nullptr;
+  char* demopt        = nullptr;
+  char* demfillopt    = nullptr;
+  char* demcacheopt   = nullptr;
   double addf{};
+  std::unique_ptr<GeoidGrid> geoid_grid;
   // include static constexpr data member definitions with intializers for grid as private members.
   #include "heightgrid.h"
 
@@ -57,13 +139,33 @@ private:
     },
     {
       "wgs84tomsl", &wgs84tomslopt, "Converts WGS84 ellipsoidal height to orthometric height (MSL)",
-      nullptr, ARGTYPE_END_REQ | ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "geoid", &geoidopt, "Geoid grid file for wgs84tomsl (GeographicLib PGM)",
+      nullptr, ARGTYPE_FILE, ARG_NOMINMAX, nullptr
+    },
+    {
+      "dem", &demopt, "Directory of SRTM .hgt tiles to take altitudes from",
+      nullptr, ARGTYPE_END_REQ | ARGTYPE_STRING, ARG_NOMINMAX, nullptr
+    },
+    {
+      "demfill", &demfillopt, "Only take altitudes from the DEM for points without one",
+      nullptr, ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "demcache", &demcacheopt, "Number of DEM tiles to keep open",
+      "16", ARGTYPE_INT, "1", nullptr, nullptr
     },
   };
 
+  /* Member Functions */
+
   static double bilinear(double x1, double y1, double x2, double y2, double x, double y, double z11, double z12, double z21, double z22);
   static double wgs84_separation(double lat, double lon);
-  void correct_height(const Waypoint* wpt);
+  void wgs84_separation(int n, const double* lat, const double* lon, double* sep) const;
+  void correct_heights(const std::vector<Waypoint*>& points) const;
+  void dem_height(DemTileCache& dem, std::vector<Waypoint*>& points) const;
 
 };
 
@@ -25,12 +25,13 @@
 #include <cmath>                // for ceil, isfinite
 #include <cstdlib>              // for abs, strtod
 #include <optional>             // for optional
+#include <vector>               // for vector
 
 #include <QString>              // for QString
 #include <QtGlobal>             // for qint64, qRound64
 
 #include "defs.h"
-#include "grtcirc.h"            // for linepart, RAD, gcdist, radtomiles
+#include "grtcirc.h"            // for linepart, RAD, gcdist_path, radtomiles
 #include "src/core/datetime.h"  // for DateTime
 #include "src/core/logging.h"   // for Fatal
 
@@ -64,7 +65,23 @@ void InterpolateFilter::process_rte(route_head* rte)
     track_swap_wpts(rte, wptlist);
   }
 
+  // The distances between the original points, computed in one batch.
+  std::vector<double> legs;
+  if (opt_dist != nullptr) {
+    std::vector<double> lat;
+    std::vector<double> lon;
+    lat.reserve(wptlist.count());
+    lon.reserve(wptlist.count());
+    foreach (const Waypoint* wpt, wptlist) {
+      lat.push_back(RAD(wpt->latitude));
+      lon.push_back(RAD(wpt->longitude));
+    }
+    legs.resize(wptlist.count());
+    gcdist_path(lat.data(), lon.data(), lat.size(), legs.data());
+  }
+
   // And add them back, with interpolated points interspersed.
+  int leg = -1;
   double lat1 = 0;
   double lon1 = 0;
   double altitude1 = unknown_alt;
@@ -92,10 +109,7 @@ void InterpolateFilter::process_rte(route_head* rte)
         // interpolate even if time is running backwards.
         npts = std::abs(*timespan) / max_time_step;
       } else if (opt_dist != nullptr) {
-        double distspan = radtomiles(gcdist(RAD(lat1),
-                                            RAD(lon1),
-                                            RAD(wpt->latitude),
-                                            RAD(wpt->longitude)));
+        double distspan = radtomiles(legs[leg]);
         npts = distspan / max_dist_step;
       }
       if (!std::isfinite(npts) || (npts >= INT_MAX)) {
@@ -109,11 +123,9 @@ void InterpolateFilter::process_rte(route_head* rte)
                       static_cast<double>(nmax + 1);
         // We create the inserted point from the Waypoint at the end of the
         // span.  Another choice would be the Waypoint at the beginning of
-        // the span.  We clear some fields but use a copy of the rest or the
-        // interpolated value.
-        auto* wpt_new = new Waypoint(*wpt);
-        wpt_new->shortname = QString();
-        wpt_new->description = QString();
+        // the span.  Names are left empty, the rest is copied from it or
+        // set to the interpolated value.
+        auto* wpt_new = Waypoint::NewInterpolated(*wpt);
         if (timespan.has_value()) {
           wpt_new->SetCreationTime(time1.addMSecs(qRound64(frac * *timespan)));
         } else {
@@ -142,6 +154,7 @@ void InterpolateFilter::process_rte(route_head* rte)
       track_add_wpt(rte, wpt);
     }
 
+    ++leg;
     lat1 = wpt->latitude;
     lon1 = wpt->longitude;
     altitude1 = wpt->altitude;
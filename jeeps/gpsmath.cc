@@ -23,17 +23,21 @@
 ********************************************************************/
 #include "jeeps/gpsmath.h"
 
+#include <algorithm>         // for min
 #include <cassert>           // for assert
 #include <cmath>             // for sin, tan, cos, pow, log, sqrt, asin, atan, exp, fabs, round
+#include <cstddef>           // for size_t
 #include <cstdint>           // for int32_t
 #include <cstdlib>           // for abs
 #include <cstring>           // for strcmp, strcpy
 #include <ctime>             // for time_t
+#include <vector>            // for vector
 
 #include <QString>           // for QString
 
-#include "defs.h"            // for case_ignore_strcmp, fatal, CSTR
+#include "defs.h"            // for fatal, Waypoint
 #include "jeeps/gpsdatum.h"  // for GPS_ODatum, GPS_OEllipse, GPS_Datums, GPS_Ellipses, UKNG, GPS_SDatum_Alias, GPS_SDatum, GPS_DatumAliases, GPS_PDatum, GPS_PDatum_Alias
+#include "jeeps/gpsnames.h"  // for GPS_Name_Lookup
 
 
 static int32_t GPS_Math_LatLon_To_UTM_Param(double lat, double lon, int32_t* zone,
@@ -1433,6 +1437,196 @@ int32_t GPS_Math_UKOSNG_Map_To_EN(const char* map, double mapE, double mapN,
 
 
 
+/* @func DatumTransform::DatumTransform ********************************
+**
+** Prepare a Molodensky transformation from one datum to another
+**
+** @param [r] Sa   [double] source semi-major axis (metres)
+** @param [r] Sif  [double] source inverse flattening
+** @param [r] Da   [double] dest semi-major axis (metres)
+** @param [r] Dif  [double] dest inverse flattening
+** @param [r] dx  [double]   dx
+** @param [r] dy  [double]   dy
+** @param [r] dz  [double]   dz
+************************************************************************/
+DatumTransform::DatumTransform(double Sa, double Sif, double Da, double Dif,
+                               double dx, double dy, double dz)
+{
+  double Sf = 1.0 / Sif;
+  double Df = 1.0 / Dif;
+
+  Sa_ = Sa;
+  esq_ = 2.0*Sf - pow(Sf,2.0);
+  one_m_esq_ = 1.0 - esq_;
+  bda_ = 1.0 - Sf;
+  da_ = Da - Sa;
+  df_ = Df - Sf;
+  dfbda_ = df_*bda_;
+  dx_ = dx;
+  dy_ = dy;
+  dz_ = dz;
+}
+
+
+
+/* @func DatumTransform::Known_Datum_To_WGS84 **************************
+**
+** Transformation from a datum to WGS84
+**
+** @param [r] n    [int32] datum number from GPS_Datums structure
+**
+** @return [DatumTransform]
+************************************************************************/
+DatumTransform DatumTransform::Known_Datum_To_WGS84(int32_t n)
+{
+  int32_t idx = GPS_Datums[n].ellipse;
+
+  return DatumTransform(GPS_Ellipses[idx].a, GPS_Ellipses[idx].invf,
+                        6378137.0, 298.257223563,
+                        GPS_Datums[n].dx, GPS_Datums[n].dy, GPS_Datums[n].dz);
+}
+
+
+
+/* @func DatumTransform::WGS84_To_Known_Datum **************************
+**
+** Transformation from WGS84 to a datum
+**
+** @param [r] n    [int32] datum number from GPS_Datums structure
+**
+** @return [DatumTransform]
+************************************************************************/
+DatumTransform DatumTransform::WGS84_To_Known_Datum(int32_t n)
+{
+  int32_t idx = GPS_Datums[n].ellipse;
+
+  return DatumTransform(6378137.0, 298.257223563,
+                        GPS_Ellipses[idx].a, GPS_Ellipses[idx].invf,
+                        -GPS_Datums[n].dx, -GPS_Datums[n].dy, -GPS_Datums[n].dz);
+}
+
+
+
+/* @func DatumTransform::molodensky ************************************
+**
+** Transform one point in place
+**
+** @param [u] phi [double *] latitude (deg)
+** @param [u] lam [double *] longitude (deg)
+** @param [u] H   [double *] height  (metres)
+**
+** @return [void]
+************************************************************************/
+inline void DatumTransform::molodensky(double* phi, double* lam, double* H) const
+{
+  double Sphi = GPS_Math_Deg_To_Rad(*phi);
+  double Slam = GPS_Math_Deg_To_Rad(*lam);
+  double SH = *H;
+
+  double phis = sin(Sphi);
+  double phic = cos(Sphi);
+  double lams = sin(Slam);
+  double lamc = cos(Slam);
+
+  double N = Sa_ /  sqrt(1.0 - esq_*pow(phis,2.0));
+
+  double tmp = one_m_esq_ /pow((1.0-esq_*pow(phis,2.0)),1.5);
+  double M   = Sa_ * tmp;
+
+  tmp  = df_ * ((M/bda_)+N*bda_) * phis * phic;
+  double tmp2 = da_ * N * esq_ * phis * phic / Sa_;
+  tmp2 += ((-dx_*phis*lamc-dy_*phis*lams) + dz_*phic);
+  double dphi = (tmp2 + tmp) / (M + SH);
+
+  double dlambda = (-dx_*lams+dy_*lamc) / ((N+SH)*phic);
+
+  double dheight = dx_*phic*lamc + dy_*phic*lams + dz_*phis - da_*(Sa_/N) +
+                   dfbda_*N*phis*phis;
+
+  *phi = GPS_Math_Rad_To_Deg(Sphi + dphi);
+  *lam = GPS_Math_Rad_To_Deg(Slam + dlambda);
+  *H   = SH + dheight;
+}
+
+
+
+/* @func DatumTransform::transform *************************************
+**
+** Transform one point
+**
+** @param [r] Sphi [double] source latitude (deg)
+** @param [r] Slam [double] source longitude (deg)
+** @param [r] SH   [double] source height  (metres)
+** @param [w] Dphi [double *] dest latitude (deg)
+** @param [w] Dlam [double *] dest longitude (deg)
+** @param [w] DH   [double *] dest height  (metres)
+**
+** @return [void]
+************************************************************************/
+void DatumTransform::transform(double Sphi, double Slam, double SH,
+                               double* Dphi, double* Dlam, double* DH) const
+{
+  molodensky(&Sphi, &Slam, &SH);
+  *Dphi = Sphi;
+  *Dlam = Slam;
+  *DH = SH;
+}
+
+
+
+/* @func DatumTransform::transform *************************************
+**
+** Transform arrays of points in place
+**
+** @param [r] count [int] number of points
+** @param [u] phi [double *] latitudes (deg)
+** @param [u] lam [double *] longitudes (deg)
+** @param [u] H   [double *] heights (metres), or nullptr for zero heights
+**
+** @return [void]
+************************************************************************/
+void DatumTransform::transform(int count, double* phi, double* lam, double* H) const
+{
+  for (int i = 0; i < count; ++i) {
+    double h = (H != nullptr) ? H[i] : 0.0;
+    molodensky(&phi[i], &lam[i], &h);
+    if (H != nullptr) {
+      H[i] = h;
+    }
+  }
+}
+
+
+
+/* @func DatumTransform::transform *************************************
+**
+** Transform the positions of waypoints, taking their heights as zero
+**
+** @param [u] points [const std::vector<Waypoint*>&] waypoints
+**
+** @return [void]
+************************************************************************/
+void DatumTransform::transform(const std::vector<Waypoint*>& points) const
+{
+  double phi[kBatch];
+  double lam[kBatch];
+
+  for (std::size_t first = 0; first < points.size(); first += kBatch) {
+    int count = std::min<std::size_t>(kBatch, points.size() - first);
+    for (int i = 0; i < count; ++i) {
+      phi[i] = points[first + i]->latitude;
+      lam[i] = points[first + i]->longitude;
+    }
+    transform(count, phi, lam);
+    for (int i = 0; i < count; ++i) {
+      points[first + i]->latitude = phi[i];
+      points[first + i]->longitude = lam[i];
+    }
+  }
+}
+
+
+
 /* @func GPS_Math_Molodensky *******************************************
 **
 ** Transform one datum to another
@@ -1458,63 +1652,7 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
                          double* DH, double Da, double Dif, double dx,
                          double dy, double dz)
 {
-  double Sf;
-  double Df;
-  double esq;
-  double bda;
-  double da;
-  double df;
-  double N;
-  double M;
-  double tmp;
-  double tmp2;
-  double dphi;
-  double dlambda;
-  double dheight;
-  double phis;
-  double phic;
-  double lams;
-  double lamc;
-
-  Sf = 1.0 / Sif;
-  Df = 1.0 / Dif;
-
-  esq = 2.0*Sf - pow(Sf,2.0);
-  bda = 1.0 - Sf;
-  Sphi = GPS_Math_Deg_To_Rad(Sphi);
-  Slam = GPS_Math_Deg_To_Rad(Slam);
-
-  da = Da - Sa;
-  df = Df - Sf;
-
-  phis = sin(Sphi);
-  phic = cos(Sphi);
-  lams = sin(Slam);
-  lamc = cos(Slam);
-
-  N = Sa /  sqrt(1.0 - esq*pow(phis,2.0));
-
-  tmp = (1.0-esq) /pow((1.0-esq*pow(phis,2.0)),1.5);
-  M   = Sa * tmp;
-
-  tmp  = df * ((M/bda)+N*bda) * phis * phic;
-  tmp2 = da * N * esq * phis * phic / Sa;
-  tmp2 += ((-dx*phis*lamc-dy*phis*lams) + dz*phic);
-  dphi = (tmp2 + tmp) / (M + SH);
-
-  dlambda = (-dx*lams+dy*lamc) / ((N+SH)*phic);
-
-  dheight = dx*phic*lamc + dy*phic*lams + dz*phis - da*(Sa/N) +
-            df*bda*N*phis*phis;
-
-  *Dphi = Sphi + dphi;
-  *Dlam = Slam + dlambda;
-  *DH   = SH   + dheight;
-
-  *Dphi = GPS_Math_Rad_To_Deg(*Dphi);
-  *Dlam = GPS_Math_Rad_To_Deg(*Dlam);
-
-  return;
+  DatumTransform(Sa,Sif,Da,Dif,dx,dy,dz).transform(Sphi,Slam,SH,Dphi,Dlam,DH);
 }
 
 
@@ -1537,28 +1675,7 @@ void GPS_Math_Known_Datum_To_WGS84_M(double Sphi, double Slam, double SH,
                                      double* Dphi, double* Dlam, double* DH,
                                      int32_t n)
 {
-  double Sa;
-  double Sif;
-  double Da;
-  double Dif;
-  double x;
-  double y;
-  double z;
-  int32_t idx;
-
-  Da  = 6378137.0;
-  Dif = 298.257223563;
-
-  idx  = GPS_Datums[n].ellipse;
-  Sa   = GPS_Ellipses[idx].a;
-  Sif  = GPS_Ellipses[idx].invf;
-  x    = GPS_Datums[n].dx;
-  y    = GPS_Datums[n].dy;
-  z    = GPS_Datums[n].dz;
-
-  GPS_Math_Molodensky(Sphi,Slam,SH,Sa,Sif,Dphi,Dlam,DH,Da,Dif,x,y,z);
-
-  return;
+  DatumTransform::Known_Datum_To_WGS84(n).transform(Sphi,Slam,SH,Dphi,Dlam,DH);
 }
 
 
@@ -1581,28 +1698,7 @@ void GPS_Math_WGS84_To_Known_Datum_M(double Sphi, double Slam, double SH,
                                      double* Dphi, double* Dlam, double* DH,
                                      int32_t n)
 {
-  double Sa;
-  double Sif;
-  double Da;
-  double Dif;
-  double x;
-  double y;
-  double z;
-  int32_t idx;
-
-  Sa  = 6378137.0;
-  Sif = 298.257223563;
-
-  idx  = GPS_Datums[n].ellipse;
-  Da   = GPS_Ellipses[idx].a;
-  Dif  = GPS_Ellipses[idx].invf;
-  x    = -GPS_Datums[n].dx;
-  y    = -GPS_Datums[n].dy;
-  z    = -GPS_Datums[n].dz;
-
-  GPS_Math_Molodensky(Sphi,Slam,SH,Sa,Sif,Dphi,Dlam,DH,Da,Dif,x,y,z);
-
-  return;
+  DatumTransform::WGS84_To_Known_Datum(n).transform(Sphi,Slam,SH,Dphi,Dlam,DH);
 }
 
 
@@ -2558,29 +2654,30 @@ void GPS_Math_UTM_EN_to_LatLon(int ReferenceEllipsoid,
 
 /********************************************************************/
 
-int32_t GPS_Lookup_Datum_Index(const char* n)
+/* Datum names and aliases, aliases first as they take precedence. */
+static const GPS_Name_Lookup<int32_t>& GPS_Datum_Names()
 {
-  const GPS_Datum* dp;
-  const GPS_Datum_Alias* al;
-
-  for (al = GPS_DatumAliases; al->alias; al++) {
-    if (case_ignore_strcmp(al->alias, n) == 0) {
-      return al->datum;
+  static const GPS_Name_Lookup<int32_t> names = []() {
+    GPS_Name_Lookup<int32_t> table;
+    for (const GPS_Datum_Alias* al = GPS_DatumAliases; al->alias; al++) {
+      table.add(al->alias, al->datum);
     }
-  }
-
-  for (dp = GPS_Datums; dp->name; dp++) {
-    if (0 == case_ignore_strcmp(dp->name, n)) {
-      return dp - GPS_Datums;
+    for (const GPS_Datum* dp = GPS_Datums; dp->name; dp++) {
+      table.add(dp->name, dp - GPS_Datums);
     }
-  }
+    return table;
+  }();
+  return names;
+}
 
-  return -1;
+int32_t GPS_Lookup_Datum_Index(const char* n)
+{
+  return GPS_Lookup_Datum_Index(QString(n));
 }
 
 int32_t GPS_Lookup_Datum_Index(const QString& n)
 {
-  return GPS_Lookup_Datum_Index(CSTR(n));
+  return GPS_Datum_Names().find(n).value_or(-1);
 }
 
 const char*
@@ -3,9 +3,12 @@
 
 #include <cstdint>   // for int32_t
 #include <ctime>     // for time_t
+#include <vector>    // for vector
 
 #include <QString>   // for QString
 
+class Waypoint;
+
 
 constexpr double GPS_PI = 3.141592653589;
 
@@ -72,6 +75,43 @@ void GPS_Math_Molodensky(double Sphi, double Slam, double SH, double Sa,
                          double Sif, double* Dphi, double* Dlam,
                          double* DH, double Da, double Dif, double dx,
                          double dy, double dz);
+
+/*
+ * Molodensky transformation from one datum to another.  Everything that
+ * only depends on the two datums is computed once, so converting many
+ * points only costs the per point trigonometry.
+ */
+class DatumTransform
+{
+public:
+  DatumTransform(double Sa, double Sif, double Da, double Dif,
+                 double dx, double dy, double dz);
+
+  static DatumTransform Known_Datum_To_WGS84(int32_t n);
+  static DatumTransform WGS84_To_Known_Datum(int32_t n);
+
+  void transform(double Sphi, double Slam, double SH,
+                 double* Dphi, double* Dlam, double* DH) const;
+  void transform(int count, double* phi, double* lam, double* H = nullptr) const;
+  void transform(const std::vector<Waypoint*>& points) const;
+
+private:
+  static constexpr int kBatch = 256;
+
+  void molodensky(double* phi, double* lam, double* H) const;
+
+  double Sa_;
+  double esq_;
+  double one_m_esq_;
+  double bda_;
+  double da_;
+  double df_;
+  double dfbda_;
+  double dx_;
+  double dy_;
+  double dz_;
+};
+
 void GPS_Math_Known_Datum_To_WGS84_M(double Sphi, double Slam, double SH,
                                      double* Dphi, double* Dlam, double* DH,
                                      int32_t n);
@@ -0,0 +1,43 @@
+#ifndef JEEPS_GPSNAMES_H_INCLUDED_
+#define JEEPS_GPSNAMES_H_INCLUDED_
+
+#include <optional>  // for optional, nullopt
+
+#include <QHash>     // for QHash
+#include <QString>   // for QString
+
+
+/*
+ * Case insensitive table of names, e.g. datum or grid names and their
+ * aliases.  Names are case folded once when the table is built, so a
+ * lookup is a single hash probe rather than a walk over the name tables
+ * comparing each entry.  If a name is added more than once the first
+ * value wins, the same result a linear search over the entries in the
+ * order they were added would give.
+ */
+template <typename T>
+class GPS_Name_Lookup
+{
+public:
+  void add(const QString& name, T value)
+  {
+    const QString key = name.toCaseFolded();
+    if (!index_.contains(key)) {
+      index_.insert(key, value);
+    }
+  }
+
+  std::optional<T> find(const QString& name) const
+  {
+    auto it = index_.constFind(name.toCaseFolded());
+    if (it == index_.constEnd()) {
+      return std::nullopt;
+    }
+    return *it;
+  }
+
+private:
+  QHash<QString, T> index_;
+};
+
+#endif // JEEPS_GPSNAMES_H_INCLUDED_
@@ -98,7 +98,9 @@
 #include <QByteArray>           // for QByteArray
 #include <QDate>                // for QDate
 #include <QDateTime>            // for QDateTime
+#include <QHash>                // for QHash
 #include <QList>                // for QList
+#include <QPair>                // for QPair
 #include <QScopedPointer>       // for QScopedPointer
 #include <QString>              // for QString, operator+, operator==, operator!=
 #include <QTextCodec>           // for QTextCodec, QTextCodec::IgnoreHeader
@@ -151,19 +153,53 @@ LowranceusrFormat::register_waypt(const Waypoint* wpt) const
 
 /* end borrowed from raymarine.c */
 
-const Waypoint*
-LowranceusrFormat::lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int uid_seq_high)
+/*
+ * Route legs refer to waypoints by unit and sequence number (USR 4) or by
+ * UUID (USR 5+).  Index every waypoint once, keeping the first match as the
+ * former linear search of the global list did, so waypoints from previously
+ * read files still take precedence.
+ */
+void
+LowranceusrFormat::lowranceusr4_index_waypts()
 {
-  // Iterate with waypt_disp_all?
+  waypt_uid_index.clear();
+  waypt_uuid_index.clear();
+  waypt_uid_index.reserve(global_waypoint_list->count());
+  if (reading_version > 4) {
+    waypt_uuid_index.reserve(global_waypoint_list->count());
+  }
+
   for (const Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
     const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
+    if (fs == nullptr) {
+      continue;
+    }
 
-    if (fs && fs->uid_unit == uid_unit &&
-        fs->uid_seq_low == uid_seq_low &&
-        fs->uid_seq_high == uid_seq_high) {
-      return waypointp;
+    const QPair<uint, quint64> uid_key(fs->uid_unit,
+                                       (quint64(uint(fs->uid_seq_high)) << 32) | uint(fs->uid_seq_low));
+    if (!waypt_uid_index.contains(uid_key)) {
+      waypt_uid_index.insert(uid_key, waypointp);
+    }
+
+    if (reading_version > 4) {
+      const QPair<quint64, quint64> uuid_key((quint64(fs->UUID1) << 32) | fs->UUID2,
+                                             (quint64(fs->UUID3) << 32) | fs->UUID4);
+      if (!waypt_uuid_index.contains(uuid_key)) {
+        waypt_uuid_index.insert(uuid_key, waypointp);
+      }
     }
   }
+}
+
+const Waypoint*
+LowranceusrFormat::lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int uid_seq_high) const
+{
+  const QPair<uint, quint64> uid_key(uid_unit,
+                                     (quint64(uint(uid_seq_high)) << 32) | uint(uid_seq_low));
+  const Waypoint* waypointp = waypt_uid_index.value(uid_key, nullptr);
+  if (waypointp) {
+    return waypointp;
+  }
 
   if (global_opts.debug_level >= 1) {
     printf(MYNAME " lowranceusr4_find_waypt: warning, failed finding waypoint with ids %u %d %d\n",
@@ -173,18 +209,13 @@ LowranceusrFormat::lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int u
 }
 
 const Waypoint*
-LowranceusrFormat::lowranceusr4_find_global_waypt(uint id1, uint id2, uint id3, uint id4)
+LowranceusrFormat::lowranceusr4_find_global_waypt(uint id1, uint id2, uint id3, uint id4) const
 {
-  // Iterate with waypt_disp_all?
-  for (const Waypoint* waypointp : std::as_const(*global_waypoint_list)) {
-    const auto* fs = reinterpret_cast<lowranceusr4_fsdata*>(waypointp->fs.FsChainFind(kFsLowranceusr4));
-
-    if (fs && fs->UUID1 == id1 &&
-        fs->UUID2 == id2 &&
-        fs->UUID3 == id3 &&
-        fs->UUID4 == id4) {
-      return waypointp;
-    }
+  const QPair<quint64, quint64> uuid_key((quint64(id1) << 32) | id2,
+                                         (quint64(id3) << 32) | id4);
+  const Waypoint* waypointp = waypt_uuid_index.value(uuid_key, nullptr);
+  if (waypointp) {
+    return waypointp;
   }
 
   if (global_opts.debug_level >= 1) {
@@ -337,6 +368,8 @@ LowranceusrFormat::rd_deinit()
 {
   gbfclose(file_in);
   utf16le_codec = nullptr;
+  waypt_uid_index.clear();
+  waypt_uuid_index.clear();
 }
 
 void
@@ -1247,6 +1280,9 @@ LowranceusrFormat::read()
   }
 
   lowranceusr_parse_waypts();
+  if (reading_version >= 4) {
+    lowranceusr4_index_waypts();
+  }
   lowranceusr_parse_routes();
 
   if ((reading_version == 2) || (reading_version == 3)) {
@@ -90,12 +90,14 @@
 #include <cmath>                // for M_PI, round, atan, exp, log, tan
 #include <cstdint>              // for int64_t
 
+#include <QHash>                // for QHash
 #include <QList>                // for QList
+#include <QPair>                // for QPair
 #include <QString>              // for QString
 #include <QTextCodec>           // for QTextCodec
 #include <QVector>              // for QVector
 #include <Qt>                   // for CaseInsensitive
-#include <QtGlobal>             // for uint
+#include <QtGlobal>             // for uint, quint64
 
 #include "defs.h"
 #include "format.h"
@@ -387,8 +389,9 @@ private:
 
   static bool same_points(const Waypoint* A, const Waypoint* B);
   void register_waypt(const Waypoint* wpt) const;
-  static const Waypoint* lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int uid_seq_high);
-  static const Waypoint* lowranceusr4_find_global_waypt(uint id1, uint id2, uint id3, uint id4);
+  void lowranceusr4_index_waypts();
+  const Waypoint* lowranceusr4_find_waypt(uint uid_unit, int uid_seq_low, int uid_seq_high) const;
+  const Waypoint* lowranceusr4_find_global_waypt(uint id1, uint id2, uint id3, uint id4) const;
   QString lowranceusr4_readstr(gbfile* file, int bytes_per_char) const;
   void lowranceusr4_writestr(const QString& buf, gbfile* file, int bytes_per_char) const;
   static gpsbabel::DateTime lowranceusr4_get_timestamp(unsigned int jd_number, unsigned int msecs);
@@ -454,6 +457,10 @@ private:
 
   QList<const Waypoint*>* waypt_table{nullptr};
 
+  /* route point resolution, (unit, sequence) and UUID to first matching waypoint */
+  QHash<QPair<uint, quint64>, const Waypoint*> waypt_uid_index;
+  QHash<QPair<quint64, quint64>, const Waypoint*> waypt_uuid_index;
+
   unsigned short waypt_out_count{};
   int            trail_count{}, lowrance_route_count{};
   int            trail_point_count{};
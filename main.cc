@@ -54,6 +54,7 @@
 #include "session.h"                  // for start_session, session_exit, session_init
 #include "src/core/datetime.h"        // for DateTime
 #include "src/core/file.h"            // for File
+#include "src/core/perfstats.h"       // for PerfStats, PerfStats::Phase
 #include "src/core/usasciicodec.h"    // for UsAsciiCodec
 #include "vecs.h"                     // for Vecs
 
@@ -146,6 +147,7 @@ usage(const char* pname, bool verbose)
     "    -b               Process command file (batch mode)\n"
     "    -x filtername    Invoke filter (placed between inputs and output)\n"
     "    -D level         Set debug level [%d]\n"
+    "    -P file          Write a JSON performance report to file\n"
     "    -h, -?           Print detailed help and exit\n"
     "    -V               Print GPSBabel version and exit\n"
     "\n"
@@ -243,6 +245,7 @@ private:
 static void
 run_reader(Vecs::fmtinfo_t& ivecs, const QString& fname)
 {
+  gpsbabel::PerfStats::Phase phase("reader", ivecs.fmtname, fname);
   if (global_opts.debug_level > 0)  {
     timer.start();
   }
@@ -276,6 +279,7 @@ run_reader(Vecs::fmtinfo_t& ivecs, const QString& fname)
 static void
 run_writer(Vecs::fmtinfo_t& ovecs, const QString& ofname)
 {
+  gpsbabel::PerfStats::Phase phase("writer", ovecs.fmtname, ofname);
   if (global_opts.debug_level > 0)  {
     timer.start();
   }
@@ -461,6 +465,7 @@ run(const char* prog_name)
       filter = FilterVecs::Instance().find_filter_vec(argument);
 
       if (filter) {
+        gpsbabel::PerfStats::Phase phase("filter", filter.fltname, QString());
         if (global_opts.debug_level > 0)  {
           timer.start();
         }
@@ -484,6 +489,8 @@ run(const char* prog_name)
           filter->deinit();
           FilterVecs::free_filter_vec(filter.flt);
         }
+        /* filters may have modified points in place */
+        waypt_invalidate_computed();
         if (global_opts.debug_level > 0)  {
           Warning().noquote() << QStringLiteral("%1: filter %2 took %3 seconds.")
                               .arg(MYNAME, filter.fltname, QString::number(timer.elapsed()/1000.0, 'f', 3));
@@ -529,6 +536,14 @@ run(const char* prog_name)
       }
       break;
 
+    case 'P':
+      argument = FETCH_OPTARG;
+      if (argument.isEmpty()) {
+        fatal("the -P option requires a file name for the performance report, i.e. -P file\n");
+      }
+      gpsbabel::PerfStats::enable(argument);
+      break;
+
     /*
      * Undocumented '-@' option for test.
      */
@@ -813,6 +828,7 @@ main(int argc, char* argv[])
   route_init();
 
   rc = run(prog_name);
+  gpsbabel::PerfStats::write_report();
 
   route_deinit();
   waypt_deinit();
@@ -21,8 +21,10 @@
 */
 
 #include <cstring>                     // for strlen, strchr, st
+#include <optional>                    // for optional
 
 #include <QByteArray>                  // for QByteArray
+#include <QDateTime>                   // for QDateTime
 #include <QIODevice>                   // for operator|, QIODevice, QIODevice::Text, QIODevice::WriteOnly
 #include <QLatin1String>               // for QLatin1String
 #include <QPair>                       // for QPair, operator==
@@ -412,65 +414,129 @@ OsmFormat::osm_strip_html(const QString& str)
   return strip_html(str);	// util.cc
 }
 
+/*
+ * Node index.
+ */
+
 void
-OsmFormat::osm_node_end(const QString& /*unused*/, const QXmlStreamAttributes* /*unused*/)
+OsmFormat::NodeIndex::clear()
 {
-  if (wpt) {
-    if (wpt->wpt_flags.fmt_use) {
-      waypt_add(wpt);
-    } else {
-      delete wpt;
+  slots_.clear();
+  count_ = 0;
+}
+
+uint64_t
+OsmFormat::NodeIndex::hash(int64_t id)
+{
+  // splitmix64 finalizer; osm ids are dense so spread them out.
+  auto x = static_cast<uint64_t>(id);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+int
+OsmFormat::NodeIndex::find(const std::vector<osm_node_t>& nodes, int64_t id) const
+{
+  if (slots_.empty()) {
+    return -1;
+  }
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = hash(id) & mask; ; i = (i + 1) & mask) {
+    const int32_t idx = slots_[i];
+    if (idx < 0) {
+      return -1;
+    }
+    if (nodes[idx].id == id) {
+      return idx;
     }
-    wpt = nullptr;
   }
 }
 
 void
-OsmFormat::osm_node(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+OsmFormat::NodeIndex::insert(const std::vector<osm_node_t>& nodes, int idx)
 {
-  wpt = new Waypoint;
+  // keep the load factor below 1/2.
+  if (2 * (count_ + 1) > static_cast<int64_t>(slots_.size())) {
+    grow(nodes);
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t i = hash(nodes[idx].id) & mask;
+  while (slots_[i] >= 0) {
+    i = (i + 1) & mask;
+  }
+  slots_[i] = idx;
+  ++count_;
+}
 
-  if (attrv->hasAttribute("id")) {
-    QString atstr = attrv->value("id").toString();
-    wpt->description =  "osm-id " + atstr;
-    if (waypoints.contains(atstr)) {
-      warning(MYNAME ": Duplicate osm-id %s!\n", qPrintable(atstr));
-    } else {
-      waypoints.insert(atstr, wpt);
-      wpt->wpt_flags.fmt_use = 1;
+void
+OsmFormat::NodeIndex::grow(const std::vector<osm_node_t>& nodes)
+{
+  std::vector<int32_t> old;
+  old.swap(slots_);
+  slots_.assign(old.empty() ? 1024 : 2 * old.size(), -1);
+  const size_t mask = slots_.size() - 1;
+  for (int32_t idx : old) {
+    if (idx >= 0) {
+      size_t i = hash(nodes[idx].id) & mask;
+      while (slots_[i] >= 0) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = idx;
     }
   }
+}
 
-  // if (attrv->hasAttribute("user")) ; // ignored
-
-  if (attrv->hasAttribute("lat")) {
-    wpt->latitude = attrv->value("lat").toDouble();
-  }
-  if (attrv->hasAttribute("lon")) {
-    wpt->longitude = attrv->value("lon").toDouble();
+/*
+ * Build a Waypoint from a packed node.
+ */
+Waypoint*
+OsmFormat::osm_node_materialize(const osm_node_t& node) const
+{
+  auto* waypoint = new Waypoint;
+  waypoint->wpt_flags.fmt_use = 1;
+  waypoint->description = "osm-id " + QString::number(node.id);
+  waypoint->latitude = node.lat;
+  waypoint->longitude = node.lon;
+  if (node.time_ms != kNoTime) {
+    waypoint->SetCreationTime(QDateTime::fromMSecsSinceEpoch(node.time_ms, Qt::UTC));
   }
+  return waypoint;
+}
 
-  if (attrv->hasAttribute("timestamp")) {
-    QString ts = attrv->value("timestamp").toString();
-    wpt->creation_time = xml_parse_time(ts);
+/*
+ * Node and way assembly, shared by the xml and pbf readers.
+ */
+
+void
+OsmFormat::osm_node_begin(std::optional<int64_t> id, double lat, double lon, int64_t time_ms)
+{
+  // The waypoint is created lazily by the first tag, see osm_node_add_tag.
+  wpt = nullptr;
+  cur_node = osm_node_t{id.value_or(0), lat, lon, time_ms, nullptr};
+  cur_node_keep = false;
+
+  // nodes without a usable id are read but discarded.
+  if (id.has_value()) {
+    if (node_index.find(nodes, *id) >= 0) {
+      warning(MYNAME ": Duplicate osm-id %lld!\n", static_cast<long long>(*id));
+    } else {
+      cur_node_keep = true;
+    }
   }
 }
 
 void
-OsmFormat::osm_node_tag(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+OsmFormat::osm_node_add_tag(const QString& key, const QString& value)
 {
-  QString key, value;
   signed char ikey;
 
-  if (attrv->hasAttribute("k")) {
-    key = attrv->value("k").toString();
-  }
-  if (attrv->hasAttribute("v")) {
-    value = attrv->value("v").toString();
-  }
-
   QString str = osm_strip_html(value);
 
+  if (wpt == nullptr) {
+    wpt = osm_node_materialize(cur_node);
+  }
+
   if (key == QLatin1String("name")) {
     if (wpt->shortname.isEmpty()) {
       wpt->shortname = str;
@@ -510,45 +576,67 @@ OsmFormat::osm_node_tag(const QString& /*unused*/, const QXmlStreamAttributes* a
 }
 
 void
-OsmFormat::osm_way(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+OsmFormat::osm_node_finish()
+{
+  if (!cur_node_keep) {
+    delete wpt;
+    wpt = nullptr;
+    return;
+  }
+  cur_node_keep = false;
+
+  if ((wpt == nullptr) && (*opt_untagged == '1')) {
+    wpt = osm_node_materialize(cur_node);
+  }
+  if (wpt) {
+    waypt_add(wpt);
+    cur_node.lat = wpt->latitude;
+    cur_node.lon = wpt->longitude;
+    cur_node.wpt = wpt;
+    wpt = nullptr;
+  }
+
+  nodes.push_back(cur_node);
+  node_index.insert(nodes, static_cast<int>(nodes.size()) - 1);
+}
+
+void
+OsmFormat::osm_way_begin(const QString& id)
 {
   rte = new route_head;
   // create a wpt to represent the route center if it has a center tag
   wpt = new Waypoint;
-  if (attrv->hasAttribute("id")) {
-    rte->rte_desc =  "osm-id " + attrv->value("id").toString();
+  if (!id.isNull()) {
+    rte->rte_desc =  "osm-id " + id;
   }
 }
 
 void
-OsmFormat::osm_way_nd(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+OsmFormat::osm_way_add_nd(int64_t ref)
 {
-  if (attrv->hasAttribute("ref")) {
-    QString atstr = attrv->value("ref").toString();
+  int idx = node_index.find(nodes, ref);
 
-    if (waypoints.contains(atstr)) {
-      const Waypoint* ctmp = waypoints.value(atstr);
-      auto* tmp = new Waypoint(*ctmp);
-      route_add_wpt(rte, tmp);
+  if (idx >= 0) {
+    const osm_node_t& node = nodes[idx];
+    Waypoint* tmp;
+    if (node.wpt) {
+      tmp = new Waypoint(*node.wpt);
     } else {
-      warning(MYNAME ": Way reference id \"%s\" wasn't listed under nodes!\n", qPrintable(atstr));
+      // mimic the shortname waypt_add would have given the node.
+      tmp = osm_node_materialize(node);
+      tmp->shortname = tmp->description;
     }
+    route_add_wpt(rte, tmp);
+  } else {
+    warning(MYNAME ": Way reference id \"%lld\" wasn't listed under nodes!\n", static_cast<long long>(ref));
   }
 }
 
 void
-OsmFormat::osm_way_tag(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+OsmFormat::osm_way_add_tag(const QString& key, const QString& value)
 {
-  QString key, value;
   signed char ikey;
 
-  if (attrv->hasAttribute("k")) {
-    key = attrv->value("k").toString();
-  }
-  if (attrv->hasAttribute("v")) {
-    value = attrv->value("v").toString();
-  }
-
   QString str = osm_strip_html(value);
 
   if (key == QLatin1String("name")) {
@@ -574,20 +662,7 @@ OsmFormat::osm_way_tag(const QString& /*unused*/, const QXmlStreamAttributes* at
 }
 
 void
-OsmFormat::osm_way_center(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
-{
-  wpt->wpt_flags.fmt_use = 1;
-
-  if (attrv->hasAttribute("lat")) {
-    wpt->latitude = attrv->value("lat").toDouble();
-  }
-  if (attrv->hasAttribute("lon")) {
-    wpt->longitude = attrv->value("lon").toDouble();
-  }
-}
-
-void
-OsmFormat::osm_way_end(const QString& /*unused*/, const QXmlStreamAttributes* /*unused*/)
+OsmFormat::osm_way_finish()
 {
   if (rte) {
     route_add_head(rte);
@@ -599,21 +674,160 @@ OsmFormat::osm_way_end(const QString& /*unused*/, const QXmlStreamAttributes* /*
       waypt_add(wpt);
     } else {
       delete wpt;
-      wpt = nullptr;
     }
+    wpt = nullptr;
   }
 }
 
 void
-OsmFormat::rd_init(const QString& fname)
+OsmFormat::osm_reader_init()
 {
   wpt = nullptr;
   rte = nullptr;
 
-  waypoints.clear();
+  nodes.clear();
+  node_index.clear();
+  cur_node_keep = false;
   if (keys.isEmpty()) {
     osm_features_init();
   }
+}
+
+void
+OsmFormat::osm_reader_deinit()
+{
+  nodes.clear();
+  nodes.shrink_to_fit();
+  node_index.clear();
+}
+
+/*
+ * XML callbacks.
+ */
+
+void
+OsmFormat::osm_node(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  double lat = 0.0;
+  double lon = 0.0;
+  int64_t time_ms = kNoTime;
+
+  // if (attrv->hasAttribute("user")) ; // ignored
+
+  if (attrv->hasAttribute("lat")) {
+    lat = attrv->value("lat").toDouble();
+  }
+  if (attrv->hasAttribute("lon")) {
+    lon = attrv->value("lon").toDouble();
+  }
+
+  if (attrv->hasAttribute("timestamp")) {
+    QString ts = attrv->value("timestamp").toString();
+    gpsbabel::DateTime dt = xml_parse_time(ts);
+    if (dt.isValid()) {
+      time_ms = dt.toMSecsSinceEpoch();
+    }
+  }
+
+  std::optional<int64_t> id;
+  if (attrv->hasAttribute("id")) {
+    QString atstr = attrv->value("id").toString();
+    bool ok;
+    id = atstr.toLongLong(&ok);
+    if (!ok) {
+      warning(MYNAME ": Invalid osm-id %s!\n", qPrintable(atstr));
+      id.reset();
+    }
+  }
+
+  osm_node_begin(id, lat, lon, time_ms);
+}
+
+void
+OsmFormat::osm_node_tag(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  QString key, value;
+
+  if (attrv->hasAttribute("k")) {
+    key = attrv->value("k").toString();
+  }
+  if (attrv->hasAttribute("v")) {
+    value = attrv->value("v").toString();
+  }
+
+  osm_node_add_tag(key, value);
+}
+
+void
+OsmFormat::osm_node_end(const QString& /*unused*/, const QXmlStreamAttributes* /*unused*/)
+{
+  osm_node_finish();
+}
+
+void
+OsmFormat::osm_way(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  QString id;
+  if (attrv->hasAttribute("id")) {
+    id = attrv->value("id").toString();
+  }
+  osm_way_begin(id);
+}
+
+void
+OsmFormat::osm_way_nd(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  if (attrv->hasAttribute("ref")) {
+    QString atstr = attrv->value("ref").toString();
+    bool ok;
+    int64_t ref = atstr.toLongLong(&ok);
+
+    if (ok) {
+      osm_way_add_nd(ref);
+    } else {
+      warning(MYNAME ": Way reference id \"%s\" wasn't listed under nodes!\n", qPrintable(atstr));
+    }
+  }
+}
+
+void
+OsmFormat::osm_way_tag(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  QString key, value;
+
+  if (attrv->hasAttribute("k")) {
+    key = attrv->value("k").toString();
+  }
+  if (attrv->hasAttribute("v")) {
+    value = attrv->value("v").toString();
+  }
+
+  osm_way_add_tag(key, value);
+}
+
+void
+OsmFormat::osm_way_center(const QString& /*unused*/, const QXmlStreamAttributes* attrv)
+{
+  wpt->wpt_flags.fmt_use = 1;
+
+  if (attrv->hasAttribute("lat")) {
+    wpt->latitude = attrv->value("lat").toDouble();
+  }
+  if (attrv->hasAttribute("lon")) {
+    wpt->longitude = attrv->value("lon").toDouble();
+  }
+}
+
+void
+OsmFormat::osm_way_end(const QString& /*unused*/, const QXmlStreamAttributes* /*unused*/)
+{
+  osm_way_finish();
+}
+
+void
+OsmFormat::rd_init(const QString& fname)
+{
+  osm_reader_init();
 
   xml_reader = new XmlGenericReader;
   xml_reader->xml_init(fname, this, osm_map);
@@ -631,7 +845,7 @@ OsmFormat::rd_deinit()
   delete xml_reader;
   xml_reader = nullptr;
 
-  waypoints.clear();
+  osm_reader_deinit();
 }
 
 /*******************************************************************************/
@@ -22,6 +22,10 @@
 #ifndef OSM_H_INCLUDED_
 #define OSM_H_INCLUDED_
 
+#include <cstdint>                     // for int64_t, int32_t, uint64_t, INT64_MIN
+#include <optional>                    // for optional
+#include <vector>                      // for vector
+
 #include <QHash>                       // for QHash
 #include <QList>                       // for QList
 #include <QPair>                       // for QPair
@@ -68,6 +72,58 @@ public:
   void wr_deinit() override;
   void exit() override;
 
+protected:
+  /* Types */
+
+  /*
+   * Nodes are kept in a packed form while reading.  Only nodes that
+   * carry tags (or all nodes if "untagged" is set) are materialized
+   * as Waypoints; way vertices are built from the packed data.
+   */
+  struct osm_node_t {
+    int64_t id;
+    double lat;
+    double lon;
+    int64_t time_ms;                   /* kNoTime if not given */
+    const Waypoint* wpt;               /* materialized waypoint or nullptr */
+  };
+
+  /* Open addressing (linear probing) from node id to nodes index. */
+  class NodeIndex
+  {
+  public:
+    void clear();
+    int find(const std::vector<osm_node_t>& nodes, int64_t id) const;
+    void insert(const std::vector<osm_node_t>& nodes, int idx);
+
+  private:
+    static uint64_t hash(int64_t id);
+    void grow(const std::vector<osm_node_t>& nodes);
+
+    std::vector<int32_t> slots_;
+    int count_{0};
+  };
+
+  /* Constants */
+
+  static constexpr int64_t kNoTime = INT64_MIN;
+
+  /* Member Functions */
+
+  void osm_reader_init();
+  void osm_reader_deinit();
+  void osm_node_begin(std::optional<int64_t> id, double lat, double lon, int64_t time_ms);
+  void osm_node_add_tag(const QString& key, const QString& value);
+  void osm_node_finish();
+  void osm_way_begin(const QString& id);
+  void osm_way_add_nd(int64_t ref);
+  void osm_way_add_tag(const QString& key, const QString& value);
+  void osm_way_finish();
+
+  /* Data Members */
+
+  char* opt_untagged{};
+
 private:
   /* Types */
 
@@ -88,6 +144,7 @@ private:
   char osm_feature_ikey(const QString& key) const;
   QString osm_feature_symbol(int ikey, const char* value) const;
   static QString osm_strip_html(const QString& str);
+  Waypoint* osm_node_materialize(const osm_node_t& node) const;
   void osm_node_end(const QString& /* unused */, const QXmlStreamAttributes* /* unused */);
   void osm_node(const QString& /* unused */, const QXmlStreamAttributes* attrv);
   void osm_node_tag(const QString& /* unused */, const QXmlStreamAttributes* attrv);
@@ -117,8 +174,16 @@ private:
     { "tag", &opt_tag, 	"Write additional way tag key/value pairs", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr},
     { "tagnd", &opt_tagnd,	"Write additional node tag key/value pairs", nullptr, ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
     { "created_by", &created_by, "Use this value as custom created_by value","GPSBabel", ARGTYPE_STRING, ARG_NOMINMAX, nullptr },
+    { "untagged", &opt_untagged, "Read untagged nodes as waypoints", "1", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
   };
 
+  /* reader node store */
+  std::vector<osm_node_t> nodes;
+  NodeIndex node_index;
+  osm_node_t cur_node{};
+  bool cur_node_keep{false};
+
+  /* writer node names */
   QHash<QString, const Waypoint*> waypoints;
 
   QHash<QString, int> keys;
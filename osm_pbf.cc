@@ -0,0 +1,679 @@
+/*
+
+	Support for "OpenStreetMap" binary data files (.osm.pbf)
+
+	Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+
+/*
+ * The file layout and message definitions are described at
+ * <https://wiki.openstreetmap.org/wiki/PBF_Format>.  Only the
+ * handful of fields we need are decoded, everything else is skipped.
+ */
+
+#include "osm_pbf.h"
+
+#include <algorithm>                   // for max, min
+#include <cstdint>                     // for int64_t, uint32_t, uint64_t, uint8_t
+#include <vector>                      // for vector
+
+#include <QByteArray>                  // for QByteArray
+#include <QIODevice>                   // for QIODevice, QIODevice::ReadOnly
+#include <QLatin1String>               // for QLatin1String
+#include <QString>                     // for QString
+#include <QThread>                     // for QThread
+#include <QThreadPool>                 // for QThreadPool
+
+#include "defs.h"
+#include "src/core/file.h"             // for File
+
+#if HAVE_LIBZ
+#include <zlib.h>
+#elif !ZLIB_INHIBITED
+#include "zlib.h"
+#endif
+
+
+#define MYNAME "osm_pbf"
+
+/*******************************************************************************/
+/*                              WIRE FORMAT                                    */
+/*-----------------------------------------------------------------------------*/
+
+enum {
+  kWireVarint = 0,
+  kWire64Bit = 1,
+  kWireLengthDelimited = 2,
+  kWire32Bit = 5
+};
+
+bool
+OsmPbfFormat::WireReader::next(uint32_t* field, uint32_t* wiretype)
+{
+  if (!ok_ || at_end()) {
+    return false;
+  }
+  uint64_t key = varint();
+  *field = key >> 3;
+  *wiretype = key & 0x7;
+  return ok_;
+}
+
+uint64_t
+OsmPbfFormat::WireReader::varint()
+{
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p_ >= end_) {
+      ok_ = false;
+      return 0;
+    }
+    uint8_t byte = *p_++;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return result;
+    }
+  }
+  ok_ = false;
+  return 0;
+}
+
+OsmPbfFormat::WireReader
+OsmPbfFormat::WireReader::bytes()
+{
+  uint64_t len = varint();
+  if (!ok_ || (len > static_cast<uint64_t>(end_ - p_))) {
+    ok_ = false;
+    return WireReader(nullptr, 0);
+  }
+  WireReader sub(reinterpret_cast<const char*>(p_), static_cast<int>(len));
+  p_ += len;
+  return sub;
+}
+
+QByteArray
+OsmPbfFormat::WireReader::bytes_array()
+{
+  WireReader sub = bytes();
+  return QByteArray(reinterpret_cast<const char*>(sub.p_), static_cast<int>(sub.end_ - sub.p_));
+}
+
+void
+OsmPbfFormat::WireReader::skip(uint32_t wiretype)
+{
+  switch (wiretype) {
+  case kWireVarint:
+    (void) varint();
+    break;
+  case kWire64Bit:
+    if (end_ - p_ < 8) {
+      ok_ = false;
+    } else {
+      p_ += 8;
+    }
+    break;
+  case kWireLengthDelimited:
+    (void) bytes();
+    break;
+  case kWire32Bit:
+    if (end_ - p_ < 4) {
+      ok_ = false;
+    } else {
+      p_ += 4;
+    }
+    break;
+  default:
+    ok_ = false;
+    break;
+  }
+}
+
+/*******************************************************************************/
+/*                                 BLOBS                                       */
+/*-----------------------------------------------------------------------------*/
+
+/*
+ * Read the next BlobHeader/Blob pair.  Returns false at end of file.
+ */
+bool
+OsmPbfFormat::pbf_read_blob(QString* type, QByteArray* blob)
+{
+  QByteArray lenbuf = ifile->read(4);
+  if (lenbuf.isEmpty()) {
+    return false;
+  }
+  if (lenbuf.size() != 4) {
+    fatal(MYNAME ": Truncated blob header length.\n");
+  }
+  int hdrlen = be_read32(lenbuf.constData());
+  if ((hdrlen <= 0) || (hdrlen > kMaxBlobHeaderSize)) {
+    fatal(MYNAME ": Invalid blob header length %d.\n", hdrlen);
+  }
+
+  QByteArray hdr = ifile->read(hdrlen);
+  if (hdr.size() != hdrlen) {
+    fatal(MYNAME ": Truncated blob header.\n");
+  }
+
+  /* BlobHeader: 1 type, 2 indexdata, 3 datasize */
+  type->clear();
+  int64_t datasize = -1;
+  WireReader rdr(hdr);
+  uint32_t field;
+  uint32_t wiretype;
+  while (rdr.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireLengthDelimited)) {
+      *type = QString::fromUtf8(rdr.bytes_array());
+    } else if ((field == 3) && (wiretype == kWireVarint)) {
+      datasize = static_cast<int64_t>(rdr.varint());
+    } else {
+      rdr.skip(wiretype);
+    }
+  }
+  if (!rdr.ok() || (datasize < 0) || (datasize > kMaxBlobSize)) {
+    fatal(MYNAME ": Invalid blob header.\n");
+  }
+
+  *blob = ifile->read(datasize);
+  if (blob->size() != datasize) {
+    fatal(MYNAME ": Truncated blob.\n");
+  }
+  return true;
+}
+
+/*
+ * Extract the payload of a Blob.  Returns an error message, or a null
+ * string on success.  Called from the worker threads, so it must not
+ * touch any shared state.
+ */
+QString
+OsmPbfFormat::pbf_inflate(const QByteArray& blob, QByteArray* raw)
+{
+  /* Blob: 1 raw, 2 raw_size, 3 zlib_data, 4 lzma_data, 6 lz4_data, 7 zstd_data */
+  int64_t raw_size = -1;
+  QByteArray zdata;
+  WireReader rdr(blob);
+  uint32_t field;
+  uint32_t wiretype;
+  while (rdr.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireLengthDelimited)) {
+      *raw = rdr.bytes_array();
+      return QString();
+    } else if ((field == 2) && (wiretype == kWireVarint)) {
+      raw_size = static_cast<int64_t>(rdr.varint());
+    } else if ((field == 3) && (wiretype == kWireLengthDelimited)) {
+      zdata = rdr.bytes_array();
+    } else if ((field >= 4) && (field <= 7)) {
+      return QStringLiteral("Unsupported blob compression (field %1).").arg(field);
+    } else {
+      rdr.skip(wiretype);
+    }
+  }
+  if (!rdr.ok() || zdata.isNull() || (raw_size < 0) || (raw_size > kMaxBlobSize)) {
+    return QStringLiteral("Invalid blob.");
+  }
+
+#if ZLIB_INHIBITED
+  return QStringLiteral("Compressed blobs require zlib support.");
+#else
+  raw->resize(static_cast<int>(raw_size));
+  auto destlen = static_cast<uLongf>(raw_size);
+  int zret = uncompress(reinterpret_cast<Bytef*>(raw->data()), &destlen,
+                        reinterpret_cast<const Bytef*>(zdata.constData()),
+                        static_cast<uLong>(zdata.size()));
+  if ((zret != Z_OK) || (destlen != static_cast<uLongf>(raw_size))) {
+    return QStringLiteral("zlib error %1 while inflating blob.").arg(zret);
+  }
+  return QString();
+#endif
+}
+
+void
+OsmPbfFormat::pbf_check_header(const QByteArray& blob)
+{
+  QByteArray raw;
+  QString error = pbf_inflate(blob, &raw);
+  if (!error.isNull()) {
+    fatal(MYNAME ": %s\n", qPrintable(error));
+  }
+
+  /* HeaderBlock: 4 required_features */
+  WireReader rdr(raw);
+  uint32_t field;
+  uint32_t wiretype;
+  while (rdr.next(&field, &wiretype)) {
+    if ((field == 4) && (wiretype == kWireLengthDelimited)) {
+      QString feature = QString::fromUtf8(rdr.bytes_array());
+      if ((feature != QLatin1String("OsmSchema-V0.6")) &&
+          (feature != QLatin1String("DenseNodes"))) {
+        fatal(MYNAME ": Unsupported required feature \"%s\".\n", qPrintable(feature));
+      }
+    } else {
+      rdr.skip(wiretype);
+    }
+  }
+  if (!rdr.ok()) {
+    fatal(MYNAME ": Invalid header block.\n");
+  }
+}
+
+/*******************************************************************************/
+/*                            PRIMITIVE BLOCKS                                 */
+/*-----------------------------------------------------------------------------*/
+
+void
+OsmPbfFormat::pbf_decode_block(pbf_block_t* block)
+{
+  QByteArray raw;
+  QString error = pbf_inflate(block->blob, &raw);
+  block->blob.clear();
+  if (error.isNull()) {
+    error = pbf_decode_primitive_block(raw, block);
+  }
+  if (!error.isNull()) {
+    block->error = error;
+  }
+}
+
+QString
+OsmPbfFormat::pbf_decode_primitive_block(const QByteArray& raw, pbf_block_t* block)
+{
+  /*
+   * PrimitiveBlock: 1 stringtable, 2 primitivegroup, 17 granularity,
+   * 18 date_granularity, 19 lat_offset, 20 lon_offset.
+   * The scaling fields may follow the groups, so collect the groups first.
+   */
+  int64_t granularity = 100;
+  int64_t date_granularity = 1000;
+  int64_t lat_offset = 0;
+  int64_t lon_offset = 0;
+  std::vector<WireReader> groups;
+
+  WireReader rdr(raw);
+  uint32_t field;
+  uint32_t wiretype;
+  while (rdr.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireLengthDelimited)) {
+      WireReader st = rdr.bytes();
+      uint32_t sfield;
+      uint32_t swiretype;
+      while (st.next(&sfield, &swiretype)) {
+        if ((sfield == 1) && (swiretype == kWireLengthDelimited)) {
+          block->strings.push_back(st.bytes_array());
+        } else {
+          st.skip(swiretype);
+        }
+      }
+      if (!st.ok()) {
+        return QStringLiteral("Invalid string table.");
+      }
+    } else if ((field == 2) && (wiretype == kWireLengthDelimited)) {
+      groups.push_back(rdr.bytes());
+    } else if ((field == 17) && (wiretype == kWireVarint)) {
+      granularity = static_cast<int64_t>(rdr.varint());
+    } else if ((field == 18) && (wiretype == kWireVarint)) {
+      date_granularity = static_cast<int64_t>(rdr.varint());
+    } else if ((field == 19) && (wiretype == kWireVarint)) {
+      lat_offset = static_cast<int64_t>(rdr.varint());
+    } else if ((field == 20) && (wiretype == kWireVarint)) {
+      lon_offset = static_cast<int64_t>(rdr.varint());
+    } else {
+      rdr.skip(wiretype);
+    }
+  }
+  if (!rdr.ok()) {
+    return QStringLiteral("Invalid primitive block.");
+  }
+
+  for (const auto& group : groups) {
+    pbf_decode_group(group, granularity, lat_offset, lon_offset, date_granularity, block);
+  }
+
+  const auto nstrings = static_cast<uint32_t>(block->strings.size());
+  for (const auto& tag : block->tags) {
+    if ((tag.key >= nstrings) || (tag.val >= nstrings)) {
+      return QStringLiteral("String table index out of range.");
+    }
+  }
+  return QString();
+}
+
+void
+OsmPbfFormat::pbf_decode_group(WireReader group, const int64_t granularity,
+                               const int64_t lat_offset, const int64_t lon_offset,
+                               const int64_t date_granularity, pbf_block_t* block)
+{
+  /* PrimitiveGroup: 1 nodes, 2 dense, 3 ways, 4 relations, 5 changesets */
+  uint32_t field;
+  uint32_t wiretype;
+  while (group.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireLengthDelimited)) {
+      pbf_decode_node(group.bytes(), granularity, lat_offset, lon_offset, date_granularity, block);
+    } else if ((field == 2) && (wiretype == kWireLengthDelimited)) {
+      pbf_decode_dense(group.bytes(), granularity, lat_offset, lon_offset, date_granularity, block);
+    } else if ((field == 3) && (wiretype == kWireLengthDelimited)) {
+      pbf_decode_way(group.bytes(), block);
+    } else {
+      group.skip(wiretype);
+    }
+  }
+  if (!group.ok() && block->error.isNull()) {
+    block->error = QStringLiteral("Invalid primitive group.");
+  }
+}
+
+void
+OsmPbfFormat::pbf_decode_tags(const std::vector<uint32_t>& keys, const std::vector<uint32_t>& vals,
+                              pbf_block_t* block)
+{
+  const size_t n = std::min(keys.size(), vals.size());
+  for (size_t i = 0; i < n; ++i) {
+    block->tags.push_back(pbf_tag_t{keys[i], vals[i]});
+  }
+}
+
+void
+OsmPbfFormat::pbf_decode_node(WireReader node, const int64_t granularity,
+                              const int64_t lat_offset, const int64_t lon_offset,
+                              const int64_t date_granularity, pbf_block_t* block)
+{
+  /* Node: 1 id, 2 keys, 3 vals, 4 info, 8 lat, 9 lon */
+  /* Info: 2 timestamp */
+  int64_t id = 0;
+  int64_t lat = 0;
+  int64_t lon = 0;
+  int64_t time_ms = kNoTime;
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> vals;
+
+  uint32_t field;
+  uint32_t wiretype;
+  while (node.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireVarint)) {
+      id = node.svarint();
+    } else if (((field == 2) || (field == 3)) && (wiretype == kWireLengthDelimited)) {
+      WireReader packed = node.bytes();
+      auto& list = (field == 2) ? keys : vals;
+      while (!packed.at_end() && packed.ok()) {
+        list.push_back(static_cast<uint32_t>(packed.varint()));
+      }
+    } else if ((field == 4) && (wiretype == kWireLengthDelimited)) {
+      WireReader info = node.bytes();
+      uint32_t ifield;
+      uint32_t iwiretype;
+      while (info.next(&ifield, &iwiretype)) {
+        if ((ifield == 2) && (iwiretype == kWireVarint)) {
+          auto ts = static_cast<int64_t>(info.varint());
+          if (ts != 0) {
+            time_ms = ts * date_granularity;
+          }
+        } else {
+          info.skip(iwiretype);
+        }
+      }
+    } else if ((field == 8) && (wiretype == kWireVarint)) {
+      lat = node.svarint();
+    } else if ((field == 9) && (wiretype == kWireVarint)) {
+      lon = node.svarint();
+    } else {
+      node.skip(wiretype);
+    }
+  }
+  if (!node.ok()) {
+    block->error = QStringLiteral("Invalid node.");
+    return;
+  }
+
+  pbf_node_t n{id,
+               1e-9 * static_cast<double>(lat_offset + (granularity * lat)),
+               1e-9 * static_cast<double>(lon_offset + (granularity * lon)),
+               time_ms,
+               static_cast<int>(block->tags.size()), 0};
+  pbf_decode_tags(keys, vals, block);
+  n.tag_end = static_cast<int>(block->tags.size());
+  block->nodes.push_back(n);
+}
+
+void
+OsmPbfFormat::pbf_decode_dense(WireReader dense, const int64_t granularity,
+                               const int64_t lat_offset, const int64_t lon_offset,
+                               const int64_t date_granularity, pbf_block_t* block)
+{
+  /* DenseNodes: 1 id, 5 denseinfo, 8 lat, 9 lon, 10 keys_vals; all delta coded */
+  /* DenseInfo: 2 timestamp (delta coded) */
+  std::vector<int64_t> ids;
+  std::vector<int64_t> lats;
+  std::vector<int64_t> lons;
+  std::vector<int64_t> timestamps;
+  WireReader keys_vals(nullptr, 0);
+
+  auto read_packed_delta = [](WireReader packed, std::vector<int64_t>& list) {
+    int64_t value = 0;
+    while (!packed.at_end() && packed.ok()) {
+      value += packed.svarint();
+      list.push_back(value);
+    }
+  };
+
+  uint32_t field;
+  uint32_t wiretype;
+  while (dense.next(&field, &wiretype)) {
+    if (wiretype != kWireLengthDelimited) {
+      dense.skip(wiretype);
+    } else if (field == 1) {
+      read_packed_delta(dense.bytes(), ids);
+    } else if (field == 5) {
+      WireReader info = dense.bytes();
+      uint32_t ifield;
+      uint32_t iwiretype;
+      while (info.next(&ifield, &iwiretype)) {
+        if ((ifield == 2) && (iwiretype == kWireLengthDelimited)) {
+          read_packed_delta(info.bytes(), timestamps);
+        } else {
+          info.skip(iwiretype);
+        }
+      }
+    } else if (field == 8) {
+      read_packed_delta(dense.bytes(), lats);
+    } else if (field == 9) {
+      read_packed_delta(dense.bytes(), lons);
+    } else if (field == 10) {
+      keys_vals = dense.bytes();
+    } else {
+      dense.skip(wiretype);
+    }
+  }
+  if (!dense.ok() || (lats.size() != ids.size()) || (lons.size() != ids.size())) {
+    block->error = QStringLiteral("Invalid dense nodes.");
+    return;
+  }
+  const bool have_time = timestamps.size() == ids.size();
+
+  block->nodes.reserve(block->nodes.size() + ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    pbf_node_t n{ids[i],
+                 1e-9 * static_cast<double>(lat_offset + (granularity * lats[i])),
+                 1e-9 * static_cast<double>(lon_offset + (granularity * lons[i])),
+                 (have_time && (timestamps[i] != 0)) ? timestamps[i] * date_granularity : kNoTime,
+                 static_cast<int>(block->tags.size()), 0};
+    // keys_vals is a sequence of (key, val) pairs per node, each node terminated by 0.
+    while (!keys_vals.at_end() && keys_vals.ok()) {
+      auto key = static_cast<uint32_t>(keys_vals.varint());
+      if (key == 0) {
+        break;
+      }
+      auto val = static_cast<uint32_t>(keys_vals.varint());
+      block->tags.push_back(pbf_tag_t{key, val});
+    }
+    n.tag_end = static_cast<int>(block->tags.size());
+    block->nodes.push_back(n);
+  }
+}
+
+void
+OsmPbfFormat::pbf_decode_way(WireReader way, pbf_block_t* block)
+{
+  /* Way: 1 id, 2 keys, 3 vals, 4 info, 8 refs (delta coded) */
+  int64_t id = 0;
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> vals;
+  auto ref_begin = static_cast<int>(block->refs.size());
+
+  uint32_t field;
+  uint32_t wiretype;
+  while (way.next(&field, &wiretype)) {
+    if ((field == 1) && (wiretype == kWireVarint)) {
+      id = static_cast<int64_t>(way.varint());
+    } else if (((field == 2) || (field == 3)) && (wiretype == kWireLengthDelimited)) {
+      WireReader packed = way.bytes();
+      auto& list = (field == 2) ? keys : vals;
+      while (!packed.at_end() && packed.ok()) {
+        list.push_back(static_cast<uint32_t>(packed.varint()));
+      }
+    } else if ((field == 8) && (wiretype == kWireLengthDelimited)) {
+      WireReader packed = way.bytes();
+      int64_t ref = 0;
+      while (!packed.at_end() && packed.ok()) {
+        ref += packed.svarint();
+        block->refs.push_back(ref);
+      }
+    } else {
+      way.skip(wiretype);
+    }
+  }
+  if (!way.ok()) {
+    block->error = QStringLiteral("Invalid way.");
+    return;
+  }
+
+  pbf_way_t w{id, ref_begin, static_cast<int>(block->refs.size()),
+              static_cast<int>(block->tags.size()), 0};
+  pbf_decode_tags(keys, vals, block);
+  w.tag_end = static_cast<int>(block->tags.size());
+  block->ways.push_back(w);
+}
+
+/*******************************************************************************/
+/*                                 READER                                      */
+/*-----------------------------------------------------------------------------*/
+
+/*
+ * Feed a decoded block through the shared osm node/way assembly.
+ * This runs on the main thread, in file order.
+ */
+void
+OsmPbfFormat::pbf_apply_block(const pbf_block_t& block)
+{
+  for (const auto& node : block.nodes) {
+    osm_node_begin(node.id, node.lat, node.lon, node.time_ms);
+    for (int i = node.tag_begin; i < node.tag_end; ++i) {
+      const pbf_tag_t& tag = block.tags[i];
+      osm_node_add_tag(QString::fromUtf8(block.strings[tag.key]),
+                       QString::fromUtf8(block.strings[tag.val]));
+    }
+    osm_node_finish();
+  }
+
+  for (const auto& way : block.ways) {
+    osm_way_begin(QString::number(way.id));
+    for (int i = way.ref_begin; i < way.ref_end; ++i) {
+      osm_way_add_nd(block.refs[i]);
+    }
+    for (int i = way.tag_begin; i < way.tag_end; ++i) {
+      const pbf_tag_t& tag = block.tags[i];
+      osm_way_add_tag(QString::fromUtf8(block.strings[tag.key]),
+                      QString::fromUtf8(block.strings[tag.val]));
+    }
+    osm_way_finish();
+  }
+}
+
+void
+OsmPbfFormat::pbf_process_batch(std::vector<pbf_block_t>& batch)
+{
+  if (batch.size() == 1) {
+    pbf_decode_block(&batch.front());
+  } else {
+    QThreadPool pool;
+    for (auto& block : batch) {
+      pbf_block_t* bp = &block;
+      pool.start([bp]() {
+        pbf_decode_block(bp);
+      });
+    }
+    pool.waitForDone();
+  }
+
+  for (const auto& block : batch) {
+    if (!block.error.isNull()) {
+      fatal(MYNAME ": %s\n", qPrintable(block.error));
+    }
+    pbf_apply_block(block);
+  }
+  batch.clear();
+}
+
+void
+OsmPbfFormat::rd_init(const QString& fname)
+{
+  osm_reader_init();
+
+  ifile = new gpsbabel::File(fname);
+  ifile->open(QIODevice::ReadOnly);
+}
+
+void
+OsmPbfFormat::read()
+{
+  // Keep a few blobs per thread in flight; each is at most kMaxBlobSize.
+  const size_t batch_size = 4 * std::max(1, QThread::idealThreadCount());
+  std::vector<pbf_block_t> batch;
+  bool have_header = false;
+
+  QString type;
+  QByteArray blob;
+  while (pbf_read_blob(&type, &blob)) {
+    if (type == QLatin1String("OSMHeader")) {
+      pbf_check_header(blob);
+      have_header = true;
+    } else if (type == QLatin1String("OSMData")) {
+      if (!have_header) {
+        fatal(MYNAME ": Missing OSMHeader block.\n");
+      }
+      batch.emplace_back();
+      batch.back().blob = blob;
+      if (batch.size() >= batch_size) {
+        pbf_process_batch(batch);
+      }
+    }
+    // Unknown blob types are skipped as the specification requires.
+  }
+  if (!batch.empty()) {
+    pbf_process_batch(batch);
+  }
+}
+
+void
+OsmPbfFormat::rd_deinit()
+{
+  ifile->close();
+  delete ifile;
+  ifile = nullptr;
+
+  osm_reader_deinit();
+}
@@ -0,0 +1,176 @@
+/*
+
+	Support for "OpenStreetMap" binary data files (.osm.pbf)
+
+	Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#ifndef OSM_PBF_H_INCLUDED_
+#define OSM_PBF_H_INCLUDED_
+
+#include <cstdint>                     // for int64_t, uint32_t, uint64_t
+#include <vector>                      // for vector
+
+#include <QByteArray>                  // for QByteArray
+#include <QString>                     // for QString
+#include <QVector>                     // for QVector
+
+#include "defs.h"
+#include "osm.h"                       // for OsmFormat
+#include "src/core/file.h"             // for File
+
+
+/*
+ * Reader for the protocol buffer encoding of OSM data.  The file is a
+ * sequence of zlib compressed blobs that are decoded in parallel and
+ * then fed, in file order, through the same node/way assembly as the
+ * xml reader.
+ */
+class OsmPbfFormat : public OsmFormat
+{
+public:
+  /* Member Functions */
+
+  QVector<arglist_t>* get_args() override
+  {
+    return &osm_pbf_args;
+  }
+
+  QVector<ff_cap> get_cap() const override
+  {
+    return {
+      ff_cap_read 			/* waypoints */,
+      ff_cap_none 			/* tracks */,
+      ff_cap_read 			/* routes */,
+    };
+  }
+
+  void rd_init(const QString& fname) override;
+  void read() override;
+  void rd_deinit() override;
+  void wr_init(const QString& fname) override
+  {
+    Format::wr_init(fname);
+  }
+
+private:
+  /* Types */
+
+  struct pbf_tag_t {
+    uint32_t key;                      /* string table index */
+    uint32_t val;                      /* string table index */
+  };
+
+  struct pbf_node_t {
+    int64_t id;
+    double lat;
+    double lon;
+    int64_t time_ms;
+    int tag_begin;
+    int tag_end;
+  };
+
+  struct pbf_way_t {
+    int64_t id;
+    int ref_begin;
+    int ref_end;
+    int tag_begin;
+    int tag_end;
+  };
+
+  /* One OSMData blob, before and after decoding. */
+  struct pbf_block_t {
+    QByteArray blob;
+    QString error;
+    std::vector<QByteArray> strings;
+    std::vector<pbf_tag_t> tags;
+    std::vector<pbf_node_t> nodes;
+    std::vector<pbf_way_t> ways;
+    std::vector<int64_t> refs;
+  };
+
+  /* Minimal protocol buffer wire format decoder. */
+  class WireReader
+  {
+  public:
+    WireReader(const char* data, int size) :
+      p_(reinterpret_cast<const uint8_t*>(data)),
+      end_(p_ + size)
+    {}
+    explicit WireReader(const QByteArray& ba) : WireReader(ba.constData(), ba.size()) {}
+
+    bool next(uint32_t* field, uint32_t* wiretype);
+    uint64_t varint();
+    int64_t svarint()
+    {
+      uint64_t v = varint();
+      return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+    WireReader bytes();
+    QByteArray bytes_array();
+    void skip(uint32_t wiretype);
+    bool at_end() const
+    {
+      return p_ >= end_;
+    }
+    bool ok() const
+    {
+      return ok_;
+    }
+
+  private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_{true};
+  };
+
+  /* Constants */
+
+  static constexpr int kMaxBlobHeaderSize = 64 * 1024;
+  static constexpr int kMaxBlobSize = 32 * 1024 * 1024;
+
+  /* Member Functions */
+
+  bool pbf_read_blob(QString* type, QByteArray* blob);
+  static QString pbf_inflate(const QByteArray& blob, QByteArray* raw);
+  static void pbf_check_header(const QByteArray& blob);
+  static void pbf_decode_block(pbf_block_t* block);
+  static QString pbf_decode_primitive_block(const QByteArray& raw, pbf_block_t* block);
+  static void pbf_decode_group(WireReader group, const int64_t granularity,
+                               const int64_t lat_offset, const int64_t lon_offset,
+                               const int64_t date_granularity, pbf_block_t* block);
+  static void pbf_decode_dense(WireReader dense, const int64_t granularity,
+                               const int64_t lat_offset, const int64_t lon_offset,
+                               const int64_t date_granularity, pbf_block_t* block);
+  static void pbf_decode_node(WireReader node, const int64_t granularity,
+                              const int64_t lat_offset, const int64_t lon_offset,
+                              const int64_t date_granularity, pbf_block_t* block);
+  static void pbf_decode_way(WireReader way, pbf_block_t* block);
+  static void pbf_decode_tags(const std::vector<uint32_t>& keys, const std::vector<uint32_t>& vals,
+                              pbf_block_t* block);
+  void pbf_process_batch(std::vector<pbf_block_t>& batch);
+  void pbf_apply_block(const pbf_block_t& block);
+
+  /* Data Members */
+
+  gpsbabel::File* ifile{nullptr};
+
+  QVector<arglist_t> osm_pbf_args = {
+    { "untagged", &opt_untagged, "Read untagged nodes as waypoints", "1", ARGTYPE_BOOL, ARG_NOMINMAX, nullptr },
+  };
+};
+#endif // OSM_PBF_H_INCLUDED_
@@ -40,6 +40,7 @@
 
 #include <cctype>                 // for tolower
 #include <cmath>                  // for lround
+#include <vector>                 // for vector
 
 #include <QByteArray>             // for QByteArray
 #include <QChar>                  // for operator==, QChar
@@ -58,7 +59,7 @@
 #include "defs.h"
 #include "csv_util.h"             // for csv_stringclean
 #include "formspec.h"             // for FormatSpecificDataList, kFsOzi
-#include "jeeps/gpsmath.h"        // for GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_M
+#include "jeeps/gpsmath.h"        // for GPS_Lookup_Datum_Index, DatumTransform
 #include "mkshort.h"              // for MakeShort
 #include "src/core/datetime.h"    // for DateTime
 #include "src/core/textstream.h"  // for TextStream
@@ -123,18 +124,6 @@ OziFormat::ozi_set_time_str(const QString& str, Waypoint* waypointp)
   }
 }
 
-void
-OziFormat::ozi_convert_datum(Waypoint* wpt) const
-{
-  if (datum != kDautmWGS84) {
-    double lat, lon, alt;
-    GPS_Math_Known_Datum_To_WGS84_M(wpt->latitude, wpt->longitude, 0.0,
-                                    &lat, &lon, &alt, datum);
-    wpt->latitude = lat;
-    wpt->longitude = lon;
-  }
-}
-
 void
 OziFormat::ozi_openfile(const QString& fname)
 {
@@ -652,6 +641,11 @@ OziFormat::read()
   QString buff;
   char* trk_name = nullptr;
   int linecount = 0;
+  /* points to convert to WGS84 once the whole file has been read. */
+  std::vector<Waypoint*> datum_pending;
+  /* waypt_add wraps and checks the position, so waypoints wait for the
+     conversion too. */
+  std::vector<Waypoint*> waypts;
 
   while (buff = stream->readLine(), !buff.isNull()) {
     linecount++;
@@ -734,7 +728,7 @@ OziFormat::read()
       switch (ozi_objective) {
       case trkdata:
         if (linecount > 6) {/* skipping over file header */
-          ozi_convert_datum(wpt_tmp);
+          datum_pending.push_back(wpt_tmp);
           track_add_wpt(trk_head, wpt_tmp);
         } else {
           delete wpt_tmp;
@@ -742,7 +736,7 @@ OziFormat::read()
         break;
       case rtedata:
         if ((linecount > 5) && !header) {/* skipping over file header */
-          ozi_convert_datum(wpt_tmp);
+          datum_pending.push_back(wpt_tmp);
           route_add_wpt(rte_head, wpt_tmp);
         } else {
           delete wpt_tmp;
@@ -753,8 +747,8 @@ OziFormat::read()
         if (linecount > 4) {  /* skipping over file header */
           ozi_fsdata_used = true;
           wpt_tmp->fs.FsChainAdd(fsdata);
-          ozi_convert_datum(wpt_tmp);
-          waypt_add(wpt_tmp);
+          datum_pending.push_back(wpt_tmp);
+          waypts.push_back(wpt_tmp);
         } else {
           delete wpt_tmp;
         }
@@ -773,6 +767,13 @@ OziFormat::read()
     }
 
   }
+
+  if (datum != kDautmWGS84) {
+    DatumTransform::Known_Datum_To_WGS84(datum).transform(datum_pending);
+  }
+  for (Waypoint* wpt : waypts) {
+    waypt_add(wpt);
+  }
 }
 
 void
@@ -96,7 +96,6 @@ private:
   ozi_fsdata* ozi_alloc_fsdata();
   static QString ozi_get_time_str(const Waypoint* waypointp);
   static void ozi_set_time_str(const QString& str, Waypoint* waypointp);
-  void ozi_convert_datum(Waypoint* wpt) const;
   void ozi_openfile(const QString& fname);
   void ozi_track_hdr(const route_head* rte);
   void ozi_track_disp(const Waypoint* waypointp);
@@ -21,7 +21,9 @@
 
 #include "polygon.h"
 
+#include <algorithm>              // for min, max
 #include <cstdio>                 // for sscanf
+#include <vector>                 // for vector
 
 #include <QString>                // for QString
 #include <QtGlobal>               // for foreach
@@ -220,13 +222,95 @@ void PolygonFilter::polytest(double lat1, double lon1,
 
 #define BADVAL 999999
 
+int PolygonFilter::poly_ring_t::bucket(double lat) const
+{
+  const auto last_bucket = static_cast<int>(bucket_start.size()) - 2;
+  double b = (lat - min_lat) * bucket_scale;
+  if (!(b > 0.0)) {
+    return 0;
+  }
+  if (b >= last_bucket) {
+    return last_bucket;
+  }
+  return static_cast<int>(b);
+}
+
+void PolygonFilter::poly_ring_t::build_index()
+{
+  constexpr int kMaxBuckets = 65536;
+
+  min_lat = max_lat = edges.front().lat1;
+  for (const auto& edge : edges) {
+    min_lat = std::min({min_lat, edge.lat1, edge.lat2});
+    max_lat = std::max({max_lat, edge.lat1, edge.lat2});
+  }
+
+  int buckets = std::min(static_cast<int>(edges.size()), kMaxBuckets);
+  bucket_scale = (max_lat > min_lat) ? buckets / (max_lat - min_lat) : 0.0;
+  if (bucket_scale == 0.0) {
+    buckets = 1;
+  }
+
+  /* Bucket of an edge spans bucket(lower end) to bucket(upper end); bucket() is monotonic. */
+  bucket_start.assign(buckets + 1, 0);
+  for (const auto& edge : edges) {
+    int lo = bucket(std::min(edge.lat1, edge.lat2));
+    int hi = bucket(std::max(edge.lat1, edge.lat2));
+    for (int b = lo; b <= hi; ++b) {
+      ++bucket_start[b + 1];
+    }
+  }
+  for (int b = 0; b < buckets; ++b) {
+    bucket_start[b + 1] += bucket_start[b];
+  }
+  bucket_edges.resize(bucket_start[buckets]);
+  std::vector<int> fill(bucket_start.cbegin(), bucket_start.cend() - 1);
+  for (int i = 0; i < static_cast<int>(edges.size()); ++i) {
+    int lo = bucket(std::min(edges[i].lat1, edges[i].lat2));
+    int hi = bucket(std::max(edges[i].lat1, edges[i].lat2));
+    for (int b = lo; b <= hi; ++b) {
+      bucket_edges[fill[b]++] = i;
+    }
+  }
+}
+
+/*
+ * Run the edges through polytest in file order, skipping the ones that
+ * don't reach the latitude of the test point.  polytest doesn't change
+ * the state for those, as they can neither cross nor touch the ray.
+ */
+bool PolygonFilter::polygon_inside(const std::vector<poly_ring_t>& rings, double wlat, double wlon)
+{
+  unsigned short state = OUTSIDE;
+  for (const auto& ring : rings) {
+    if (!((wlat >= ring.min_lat) && (wlat <= ring.max_lat))) {
+      continue;
+    }
+    int b = ring.bucket(wlat);
+    for (int k = ring.bucket_start[b]; k < ring.bucket_start[b + 1]; ++k) {
+      const poly_edge_t& edge = ring.edges[ring.bucket_edges[k]];
+      if ((wlat < std::min(edge.lat1, edge.lat2)) || (wlat > std::max(edge.lat1, edge.lat2))) {
+        continue;
+      }
+      if (edge.lat2 == wlat && edge.lon2 == wlon) {
+        /* points on a vertex are inside */
+        return true;
+      }
+      polytest(edge.lat1, edge.lon1, edge.lat2, edge.lon2,
+               wlat, wlon, &state, edge.first, edge.last);
+    }
+  }
+  return (state & INSIDE) != OUTSIDE;
+}
+
 void PolygonFilter::process()
 {
-  extra_data* ed;
   int fileline = 0;
   int first = 1;
   int last = 0;
   QString line;
+  std::vector<poly_ring_t> rings;
+  bool new_ring = true;
 
   gpsbabel::TextStream stream;
   stream.open(polyfileopt, QIODevice::ReadOnly, MYNAME);
@@ -254,30 +338,17 @@ void PolygonFilter::process()
               fileline);
     } else if (lat1 != BADVAL && lon1 != BADVAL &&
                lat2 != BADVAL && lon2 != BADVAL) {
-      foreach (Waypoint* waypointp, *global_waypoint_list) {
-        if (waypointp->extra_data) {
-          ed = (extra_data*) waypointp->extra_data;
-        } else {
-          ed = new extra_data;
-          ed->state = OUTSIDE;
-          ed->override = 0;
-          waypointp->extra_data = ed;
-        }
-        if (lat2 == waypointp->latitude &&
-            lon2 == waypointp->longitude) {
-          ed->override = 1;
-        }
-        if (olat != BADVAL && olon != BADVAL &&
-            olat == lat2 && olon == lon2) {
-          last = 1;
-        }
-        polytest(lat1, lon1, lat2, lon2,
-                 waypointp->latitude,
-                 waypointp->longitude,
-                 &ed->state, first, last);
-        first = 0;
-        last = 0;
+      if (olat != BADVAL && olon != BADVAL &&
+          olat == lat2 && olon == lon2) {
+        last = 1;
       }
+      if (new_ring) {
+        rings.emplace_back();
+        new_ring = false;
+      }
+      rings.back().edges.push_back({lat1, lon1, lat2, lon2, first != 0, last != 0});
+      first = 0;
+      last = 0;
     }
     if (olat != BADVAL && olon != BADVAL &&
         olat == lat2 && olon == lon2) {
@@ -286,11 +357,13 @@ void PolygonFilter::process()
       lat1 = BADVAL;
       lon1 = BADVAL;
       first = 1;
+      new_ring = true;
     } else if (lat1 == BADVAL || lon1 == BADVAL) {
       olat = lat2;
       olon = lon2;
       lat1 = lat2;
       lon1 = lon2;
+      new_ring = true;
     } else {
       lat1 = lat2;
       lon1 = lon2;
@@ -298,17 +371,17 @@ void PolygonFilter::process()
   }
   stream.close();
 
+  if (rings.empty()) {
+    return;
+  }
+  for (auto& ring : rings) {
+    ring.build_index();
+  }
+
+  waypt_run_mutation_hook();
   foreach (Waypoint* wp, *global_waypoint_list) {
-    if (wp->extra_data) {
-      ed = (extra_data*) wp->extra_data;
-      wp->extra_data = nullptr;
-      if (ed->override) {
-        ed->state = INSIDE;
-      }
-      if (((ed->state & INSIDE) == OUTSIDE) == (exclopt == nullptr)) {
-        wp->wpt_flags.marked_for_deletion = 1;
-      }
-      delete ed;
+    if (polygon_inside(rings, wp->latitude, wp->longitude) == (exclopt != nullptr)) {
+      wp->wpt_flags.marked_for_deletion = 1;
     }
   }
   del_marked_wpts();
@@ -22,6 +22,8 @@
 #ifndef POLYGON_H_INCLUDED_
 #define POLYGON_H_INCLUDED_
 
+#include <vector>          // for vector
+
 #include <QVector>         // for QVector
 
 #include "defs.h"    // for ARG_NOMINMAX, arglist_t, ARGTYPE_BOOL, ARGTYPE_FILE
@@ -41,9 +43,30 @@ public:
 private:
   /* Types */
 
-  struct extra_data {
-    unsigned short state;
-    unsigned short override;
+  struct poly_edge_t {
+    double lat1;
+    double lon1;
+    double lat2;
+    double lon2;
+    bool first;
+    bool last;
+  };
+
+  /*
+   * A chain of consecutive edges as read from the file, usually one
+   * closed ring.  The edges are bucketed by latitude so a test point
+   * only visits the edges whose latitude range contains it.
+   */
+  struct poly_ring_t {
+    std::vector<poly_edge_t> edges;
+    double min_lat{};
+    double max_lat{};
+    double bucket_scale{};
+    std::vector<int> bucket_start;      /* offsets into bucket_edges, one per bucket plus one */
+    std::vector<int> bucket_edges;      /* edge indexes, ascending within each bucket */
+
+    int bucket(double lat) const;
+    void build_index();
   };
 
   /* Member Functions */
@@ -52,6 +75,7 @@ private:
                 double lat2, double lon2,
                 double wlat, double wlon,
                 unsigned short* state, int first, int last);
+  static bool polygon_inside(const std::vector<poly_ring_t>& rings, double wlat, double wlon);
 
   /* Data Members */
 
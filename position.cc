@@ -28,7 +28,9 @@
 #include <QtGlobal>             // for qRound64, qint64
 
 #include "defs.h"
+#include "grtcirc.h"            // for radtometers
 #include "src/core/datetime.h"  // for DateTime
+#include "src/core/nvector.h"   // for NVectorArray
 
 #if FILTERS_ENABLED
 
@@ -43,27 +45,44 @@ void PositionFilter::position_runqueue(const WaypointList& waypt_list, int qtype
     }
     int nelems = qlist.size();
 
+    /*
+     * Most pairs are decided by comparing the chord between the cached
+     * n-vectors with a band around pos_dist; only pairs inside the band
+     * fall back to the great circle distance.
+     */
+    const gpsbabel::NVectorArray& nvectors = waypt_list.nvectors();
+    const gpsbabel::NVectorArray::ChordBand band = gpsbabel::NVectorArray::band(pos_dist / radtometers(1.0));
+
     for (int i = 0 ; i < nelems ; ++i) {
       if (!qlist.at(i).deleted) {
         bool something_deleted = false;
+        Waypoint* wpti = qlist.at(i).wpt;
 
         for (int j = i + 1 ; j < nelems ; ++j) {
           if (!qlist.at(j).deleted) {
-            double dist = gc_distance(qlist.at(j).wpt->latitude,
-                                      qlist.at(j).wpt->longitude,
-                                      qlist.at(i).wpt->latitude,
-                                      qlist.at(i).wpt->longitude);
+            Waypoint* wptj = qlist.at(j).wpt;
+            const double chord2 = nvectors.chord2(i, j);
+            bool within;
+            if (chord2 < band.below2) {
+              within = true;
+            } else if (chord2 > band.above2) {
+              within = false;
+            } else {
+              double dist = gc_distance(wptj->latitude, wptj->longitude,
+                                        wpti->latitude, wpti->longitude);
+              within = dist <= pos_dist;
+            }
 
-            if (dist <= pos_dist) {
+            if (within) {
               if (check_time) {
-                qint64 diff_time = std::abs(qlist.at(j).wpt->creation_time.msecsTo(qlist.at(i).wpt->creation_time));
+                qint64 diff_time = std::abs(wptj->creation_time.msecsTo(wpti->creation_time));
                 if (diff_time >= max_diff_time) {
                   continue;
                 }
               }
 
               qlist[j].deleted = true;
-              qlist.at(j).wpt->wpt_flags.marked_for_deletion = 1;
+              wptj->wpt_flags.marked_for_deletion = 1;
               something_deleted = true;
             } else {
               // Unlike waypoints, routes and tracks are ordered paths.
@@ -77,7 +96,7 @@ void PositionFilter::position_runqueue(const WaypointList& waypt_list, int qtype
         }
 
         if (something_deleted && (purge_duplicates != nullptr)) {
-          qlist.at(i).wpt->wpt_flags.marked_for_deletion = 1;
+          wpti->wpt_flags.marked_for_deletion = 1;
         }
       }
     }
@@ -86,6 +105,7 @@ void PositionFilter::position_runqueue(const WaypointList& waypt_list, int qtype
 
 void PositionFilter::process()
 {
+  waypt_run_mutation_hook();
   position_runqueue(*global_waypoint_list, wptdata);
   del_marked_wpts();
 
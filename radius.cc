@@ -21,41 +21,108 @@
 
 #include "radius.h"
 
+#include <algorithm>        // for nth_element, sort
 #include <cstdlib>          // for strtod
 #include <utility>          // for as_const
+#include <vector>           // for vector
 
 #include <QString>          // for QString
-#include <QtGlobal>         // QAddConst<>::Type, foreach
+#include <QtGlobal>         // QAddConst<>::Type
 
-#include "defs.h"           // for Waypoint, del_marked_wpts, route_add_head, route_add_wpt, waypt_add, waypt_sort, waypt_swap, xstrtoi, route_head, WaypointList, kMilesPerKilometer
+#include "defs.h"           // for Waypoint, route_add_head, route_add_wpt, waypt_add, waypt_swap, xstrtoi, route_head, WaypointList, kMilesPerKilometer
+#include "grtcirc.h"        // for RAD, gcdist_from, radtomiles
+#include "src/core/nvector.h"  // for NVectorArray
 
 
 #if FILTERS_ENABLED
 
 void RadiusFilter::process()
 {
-  foreach (Waypoint* waypointp, *global_waypoint_list) {
-    double dist = gc_distance(waypointp->latitude, waypointp->longitude,
-                              home_pos->latitude, home_pos->longitude);
+  const bool sorted = (nosort == nullptr);
+  const bool limited = (maxctarg != nullptr);
 
-    if ((dist >= pos_dist) == (exclopt == nullptr)) {
-      waypointp->wpt_flags.marked_for_deletion = 1;
+  WaypointList comp;
+  waypt_swap(comp);
+
+  /*
+   * Most points are classified by comparing the chord from the home
+   * n-vector with a band around pos_dist.  The great circle distance is
+   * only needed for points inside the band and to sort, and is computed
+   * for those in one batch.
+   */
+  const gpsbabel::NVectorArray& nvectors = comp.nvectors();
+  const gpsbabel::NVectorArray::ChordBand band = gpsbabel::NVectorArray::band(pos_dist / radtomiles(1.0));
+  double home[3];
+  gpsbabel::NVectorArray::unit(home_pos->latitude, home_pos->longitude, home);
+
+  const int npts = comp.count();
+  std::vector<signed char> within(npts);  /* 1 within, 0 beyond, -1 undecided */
+  std::vector<double> lat;
+  std::vector<double> lon;
+  int index = 0;
+  for (const Waypoint* waypointp : std::as_const(comp)) {
+    const double chord2 = gpsbabel::NVectorArray::chord2(home, nvectors.at(index));
+    if (chord2 < band.below2) {
+      within[index] = 1;
+    } else if (chord2 > band.above2) {
+      within[index] = 0;
     } else {
-      auto* ed = new extra_data;
-      ed->distance = dist;
-      waypointp->extra_data = ed;
+      within[index] = -1;
+    }
+    if ((within[index] < 0) || (sorted && ((within[index] != 0) == (exclopt == nullptr)))) {
+      lat.push_back(RAD(waypointp->latitude));
+      lon.push_back(RAD(waypointp->longitude));
     }
+    ++index;
   }
-  del_marked_wpts();
+  std::vector<double> dists(lat.size());
+  gcdist_from(RAD(home_pos->latitude), RAD(home_pos->longitude),
+              lat.data(), lon.data(), lat.size(), dists.data());
+
+  std::vector<candidate> kept;
+  index = 0;
+  int next_dist = 0;
+  for (Waypoint* waypointp : std::as_const(comp)) {
+    double dist = 0.0;
+    bool keep;
+    if (within[index] < 0) {
+      dist = radtomiles(dists[next_dist++]);
+      keep = (dist >= pos_dist) != (exclopt == nullptr);
+    } else {
+      keep = (within[index] != 0) == (exclopt == nullptr);
+      if (keep && sorted) {
+        dist = radtomiles(dists[next_dist++]);
+      }
+    }
 
-  if (nosort == nullptr) {
-    auto dist_comp_lambda = [](const Waypoint* a, const Waypoint* b)->bool {
-      const auto* aed = static_cast<const extra_data*>(a->extra_data);
-      const auto* bed = static_cast<const extra_data*>(b->extra_data);
-      return aed->distance < bed->distance;
+    if (keep) {
+      kept.push_back({dist, index, waypointp});
+    } else {
+      delete waypointp;
+    }
+    ++index;
+  }
+
+  /*
+   * The result is the stable sort by distance truncated to maxcount, so
+   * select the maxcount nearest first and only sort those.
+   */
+  auto size = static_cast<int>(kept.size());
+  int count = (limited && (maxct < size)) ? maxct : size;
+  if (sorted) {
+    auto dist_comp_lambda = [](const candidate& a, const candidate& b)->bool {
+      return (a.distance < b.distance) ||
+             ((a.distance == b.distance) && (a.index < b.index));
     };
-    waypt_sort(dist_comp_lambda);
+    if (count < size) {
+      std::nth_element(kept.begin(), kept.begin() + count, kept.end(), dist_comp_lambda);
+    }
+    std::sort(kept.begin(), kept.begin() + count, dist_comp_lambda);
+  }
+  for (int i = count; i < size; ++i) {
+    delete kept[i].wpt;
   }
+  kept.resize(count);
 
   route_head* rte_head = nullptr;
   if (routename != nullptr) {
@@ -65,29 +132,15 @@ void RadiusFilter::process()
   }
 
   /*
-   * Create an list of remaining waypoints.
-   * Delete them, add them to the global waypoint list, or add them
-   * to a new route.
+   * Add the remaining waypoints to the global waypoint list, or to a
+   * new route.
    */
-
-  WaypointList comp;
-  waypt_swap(comp);
-
-  int i = 0;
-  for (Waypoint* wp : std::as_const(comp)) {
-    delete static_cast<extra_data*>(wp->extra_data);
-    wp->extra_data = nullptr;
-
-    if ((maxctarg != nullptr) && (i >= maxct)) {
-      delete wp;
+  for (const candidate& c : kept) {
+    if (routename != nullptr) {
+      route_add_wpt(rte_head, c.wpt);
     } else {
-      if (routename != nullptr) {
-        route_add_wpt(rte_head, wp);
-      } else {
-        waypt_add(wp);
-      }
+      waypt_add(c.wpt);
     }
-    ++i;
   }
 }
 
@@ -27,7 +27,6 @@
 
 #include "defs.h"     // for arglist_t, ARG_NOMINMAX, ARGTYPE_FLOAT, ARGTYPE_REQUIRED, ARGTYPE_BOOL, ARGTYPE_INT, ARGTYPE_STRING, Waypoint
 #include "filter.h"   // for Filter
-#include "grtcirc.h"  // for RAD, gcdist, radtomiles
 
 #if FILTERS_ENABLED
 
@@ -45,17 +44,12 @@ public:
 private:
   /* Types */
 
-  struct extra_data {
+  struct candidate {
     double distance;
+    int index;                /* position in the input, for stable ordering */
+    Waypoint* wpt;
   };
 
-  /* Member Functions */
-
-  static double gc_distance(double lat1, double lon1, double lat2, double lon2)
-  {
-    return radtomiles(gcdist(RAD(lat1), RAD(lon1), RAD(lat2), RAD(lon2)));
-  }
-
   /* Data Members */
 
   double pos_dist{};
@@ -22,9 +22,9 @@
 #include "resample.h"
 
 #include <cmath>                // for round
-#include <optional>             // for optional
 #include <tuple>                // for tuple, tuple_element<>::type
 #include <utility>              // for as_const
+#include <vector>               // for vector
 
 #include <QDebug>               // for QDebug
 #include <QList>                // for QList<>::const_iterator
@@ -43,21 +43,20 @@
 #define MYNAME "resample"
 
 
-void ResampleFilter::average_waypoint(Waypoint* wpt, bool zero_stuffed)
+void ResampleFilter::average_sample(sample_t& sample, bool zero_stuffed, bool zero)
 {
   // We filter in the n-vector coordinate system.
   // This removes difficulties at the discontinuity at longitude = +/- 180 degrees,
   // as well as at the singularities at the poles.
   // Our filter is from Gade, 5.3.6. Horizontal geographical mean, equation 17.
   gpsbabel::NVector current_position;
-  if (wpt->extra_data) { // zero stuffing?
+  if (zero) { // zero stuffing?
     current_position = gpsbabel::Vector3D(0.0, 0.0, 0.0);
-    wpt->extra_data = nullptr;
   } else {
-    current_position = gpsbabel::NVector(wpt->latitude, wpt->longitude);
+    current_position = gpsbabel::NVector(sample.latitude, sample.longitude);
   }
-  int current_altitude_valid_count = wpt->altitude != unknown_alt? 1 : 0;
-  double current_altitude =  wpt->altitude != unknown_alt? wpt->altitude : 0.0;
+  int current_altitude_valid_count = sample.altitude != unknown_alt? 1 : 0;
+  double current_altitude =  sample.altitude != unknown_alt? sample.altitude : 0.0;
   auto current = std::tuple(current_position, current_altitude_valid_count, current_altitude);
 
   if (history.isEmpty()) {
@@ -116,65 +115,145 @@ void ResampleFilter::average_waypoint(Waypoint* wpt, bool zero_stuffed)
   }
 
   gpsbabel::NVector normalized_position = accumulated_position / accumulated_position.norm();
-  wpt->latitude = normalized_position.latitude();
-  wpt->longitude = normalized_position.longitude();
+  sample.latitude = normalized_position.latitude();
+  sample.longitude = normalized_position.longitude();
   if (accumulated_altitude_valid_count == average_count) {
-    wpt->altitude = accumulated_altitude * filter_gain;
+    sample.altitude = accumulated_altitude * filter_gain;
   } else {
-    wpt->altitude = unknown_alt;
+    sample.altitude = unknown_alt;
   }
 
   counter = (counter + 1) % average_count;
 }
 
-void ResampleFilter::interpolate_rte(route_head* rte)
+/*
+ * Interpolation, averaging and decimation of one track in a single pass
+ * over its samples.  The zero stuffed points between the originals only
+ * exist as entries in a compact sample array; the averaging filter runs
+ * over that array, and Waypoints are created only for the interpolated
+ * samples that survive decimation.  The arithmetic is the same as running
+ * the three steps one after the other on materialized points.
+ */
+void ResampleFilter::resample_rte(route_head* rte)
 {
+  if (rte->waypoint_list.empty()) {
+    return;
+  }
+
   // Steal all the wpts
   WaypointList wptlist;
   track_swap_wpts(rte, wptlist);
 
-  // And add them back, with zero stuffed points interspersed.
-  bool first = true;
-  const Waypoint* prevwpt;
-  foreach (Waypoint* wpt, wptlist) {
-    if (first) {
-      first = false;
+  // Filter in the forward direction, zero stuffing between the originals.
+  const int npts = wptlist.count();
+  const int nsamples = (npts - 1) * interpolate_count + 1;
+  std::vector<sample_t> samples(nsamples);
+  history.clear();
+  for (int k = 0; k < nsamples; ++k) {
+    sample_t& sample = samples[k];
+    if (k % interpolate_count == 0) {
+      const Waypoint* wpt = wptlist.at(k / interpolate_count);
+      sample = {wpt->latitude, wpt->longitude, wpt->altitude};
+      average_sample(sample, true, false);
     } else {
-      std::optional<qint64> timespan;
-      if (prevwpt->creation_time.isValid() && wpt->creation_time.isValid()) {
-        timespan = wpt->creation_time.toMSecsSinceEpoch() -
-                   prevwpt->creation_time.toMSecsSinceEpoch();
+      sample = {0.0, 0.0, 0.0};
+      average_sample(sample, true, true);
+    }
+  }
+
+  // Filter in the reverse direction
+  if (global_opts.debug_level >= 5) {
+    qDebug() << "Backward pass";
+  }
+  history.clear();
+  for (auto it = samples.rbegin(); it != samples.rend(); ++it) {
+    average_sample(*it, false, false);
+  }
+
+  // And add back the samples that survive decimation.
+  const int keep_every = decimateopt ? decimate_count : 1;
+  bool inherit_new_trkseg = false;
+  for (int k = 0; k < nsamples; ++k) {
+    const int index = k / interpolate_count;
+    const int phase = k % interpolate_count;
+    Waypoint* prevwpt = wptlist.at(index);
+    if (k % keep_every != 0) {
+      // A dropped original passes its segment start to the next survivor.
+      if ((phase == 0) && prevwpt->wpt_flags.new_trkseg) {
+        inherit_new_trkseg = true;
       }
+      continue;
+    }
 
-      // Insert the required points
-      for (int n = 0; n < interpolate_count - 1; ++n) {
-        double frac = static_cast<double>(n + 1) /
+    Waypoint* wpt;
+    if (phase == 0) {
+      wpt = prevwpt;
+    } else {
+      // We create the inserted point from the Waypoint at the
+      // beginning of the span.  Names are left empty, the rest is
+      // copied from it or set to the interpolated value.
+      const Waypoint* nextwpt = wptlist.at(index + 1);
+      wpt = Waypoint::NewInterpolated(*prevwpt);
+      wpt->wpt_flags.new_trkseg = 0;
+      if (prevwpt->creation_time.isValid() && nextwpt->creation_time.isValid()) {
+        qint64 timespan = nextwpt->creation_time.toMSecsSinceEpoch() -
+                          prevwpt->creation_time.toMSecsSinceEpoch();
+        double frac = static_cast<double>(phase) /
                       static_cast<double>(interpolate_count);
-        // We create the inserted point from the Waypoint at the
-        // beginning of the span.  We clear some fields but use a
-        // copy of the rest or the interpolated value.
-        auto* wpt_new = new Waypoint(*prevwpt);
-        wpt_new->wpt_flags.new_trkseg = 0;
-        wpt_new->shortname = QString();
-        wpt_new->description = QString();
-        if (timespan.has_value()) {
-          wpt_new->SetCreationTime(0, prevwpt->creation_time.toMSecsSinceEpoch() +
-                                   round(frac * *timespan));
-        } else {
-          wpt_new->creation_time = gpsbabel::DateTime();
-        }
-        // zero stuff
-        wpt_new->latitude = 0.0;
-        wpt_new->longitude = 0.0;
-        wpt_new->altitude = 0.0;
-        wpt_new->extra_data = &wpt_zero_stuffed;
-        track_add_wpt(rte, wpt_new);
+        wpt->SetCreationTime(0, prevwpt->creation_time.toMSecsSinceEpoch() +
+                             round(frac * timespan));
+      } else {
+        wpt->creation_time = gpsbabel::DateTime();
       }
     }
     wpt->extra_data = nullptr;
+    wpt->latitude = samples[k].latitude;
+    wpt->longitude = samples[k].longitude;
+    wpt->altitude = samples[k].altitude;
+    if (inherit_new_trkseg) {
+      wpt->wpt_flags.new_trkseg = 1;
+      inherit_new_trkseg = false;
+    }
     track_add_wpt(rte, wpt);
+  }
 
-    prevwpt = wpt;
+  // Originals that did not survive decimation are no longer referenced.
+  for (int index = 0; index < npts; ++index) {
+    if ((index * interpolate_count) % keep_every != 0) {
+      delete wptlist.at(index);
+    }
+  }
+}
+
+void ResampleFilter::average_rte(const route_head* rte)
+{
+  std::vector<sample_t> samples;
+  samples.reserve(rte->rte_waypt_ct());
+  foreach (const Waypoint* wpt, rte->waypoint_list) {
+    samples.push_back({wpt->latitude, wpt->longitude, wpt->altitude});
+  }
+
+  // Filter in the forward direction
+  history.clear();
+  for (auto& sample : samples) {
+    average_sample(sample, false, false);
+  }
+
+  // Filter in the reverse direction
+  if (global_opts.debug_level >= 5) {
+    qDebug() << "Backward pass";
+  }
+  history.clear();
+  for (auto it = samples.rbegin(); it != samples.rend(); ++it) {
+    average_sample(*it, false, false);
+  }
+
+  auto it = samples.cbegin();
+  foreach (Waypoint* wpt, rte->waypoint_list) {
+    wpt->latitude = it->latitude;
+    wpt->longitude = it->longitude;
+    wpt->altitude = it->altitude;
+    ++it;
   }
 }
 
@@ -197,34 +276,19 @@ void ResampleFilter::process()
       fatal(FatalMsg() << MYNAME ": Found no tracks to operate on.");
     }
 
-    auto interpolate_rte_lambda = [this](const route_head* rte)->void {
-      interpolate_rte(const_cast<route_head*>(rte));
+    // interpolation requires averaging, and decimation is done in the same pass.
+    auto resample_rte_lambda = [this](const route_head* rte)->void {
+      resample_rte(const_cast<route_head*>(rte));
     };
-    track_disp_all(interpolate_rte_lambda, nullptr, nullptr);
+    track_disp_all(resample_rte_lambda, nullptr, nullptr);
+    return;
   }
 
   if (averageopt) {
-    auto route_hdr = [this](const route_head* rte)->void {
-      // Filter in the forward direction
-      history.clear();
-      for (auto it = rte->waypoint_list.cbegin(); it != rte->waypoint_list.cend(); ++it)
-      {
-        average_waypoint(*it, interpolateopt);
-      }
-
-      // Filter in the reverse direction
-      if (global_opts.debug_level >= 5)
-      {
-        qDebug() << "Backward pass";
-      }
-      history.clear();
-      for (auto it = rte->waypoint_list.crbegin(); it != rte->waypoint_list.crend(); ++it)
-      {
-        average_waypoint(*it, false);
-      }
+    auto average_rte_lambda = [this](const route_head* rte)->void {
+      average_rte(rte);
     };
-
-    track_disp_all(route_hdr, nullptr, nullptr);
+    track_disp_all(average_rte_lambda, nullptr, nullptr);
   }
 
   if (decimateopt) {
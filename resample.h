@@ -47,10 +47,20 @@ public:
 
 private:
 
+  /* Types */
+
+  /* The coordinates the averaging filter reads and rewrites. */
+  struct sample_t {
+    double latitude;
+    double longitude;
+    double altitude;
+  };
+
   /* Member Functions */
 
-  void average_waypoint(Waypoint* wpt, bool zero_stuffed);
-  void interpolate_rte(route_head* rte);
+  void average_sample(sample_t& sample, bool zero_stuffed, bool zero);
+  void resample_rte(route_head* rte);
+  void average_rte(const route_head* rte);
   void decimate_rte(const route_head* rte);
 
   /* Data Members */
@@ -60,7 +70,6 @@ private:
   int accumulated_altitude_valid_count{0};
   double accumulated_altitude{0.0};
   double filter_gain{0.0};
-  int wpt_zero_stuffed{};
 
   int counter{0};
   int average_count{0};
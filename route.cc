@@ -19,8 +19,11 @@
 
 #include <cassert>              // for assert
 #include <cstddef>              // for nullptr_t
+#include <functional>           // for function
+#include <memory>               // for make_unique, unique_ptr
 #include <optional>             // for optional, operator>, operator<
-#include <utility>              // for as_const
+#include <utility>              // for move
+#include <vector>               // for vector
 
 #include <QDateTime>            // for operator>, QDateTime, operator<
 #include <QList>                // for QList<>::const_iterator
@@ -31,7 +34,7 @@
 
 #include "defs.h"
 #include "formspec.h"           // for FormatSpecificDataList
-#include "grtcirc.h"            // for RAD, gcdist, heading_true_degrees, radtometers
+#include "grtcirc.h"            // for RAD, gcdist_path, heading_true_degrees_path, radtometers
 #include "session.h"            // for curr_session, session_t (ptr only)
 #include "src/core/datetime.h"  // for DateTime
 
@@ -39,6 +42,10 @@
 RouteList* global_route_list;
 RouteList* global_track_list;
 
+/* Run before the global routes or tracks are next changed, see route_set_mutation_hook. */
+static std::function<void()> route_mutation_hook;
+static std::function<void()> track_mutation_hook;
+
 void
 route_init()
 {
@@ -75,36 +82,42 @@ track_count()
 void
 route_add_head(route_head* rte)
 {
+  route_run_mutation_hook();
   global_route_list->add_head(rte);
 }
 
 void
 route_del_head(route_head* rte)
 {
+  route_run_mutation_hook();
   global_route_list->del_head(rte);
 }
 
 void
 track_add_head(route_head* rte)
 {
+  track_run_mutation_hook();
   global_track_list->add_head(rte);
 }
 
 void
 track_del_head(route_head* rte)
 {
+  track_run_mutation_hook();
   global_track_list->del_head(rte);
 }
 
 void
 track_insert_head(route_head* rte, route_head* predecessor)
 {
+  track_run_mutation_hook();
   global_track_list->insert_head(rte, predecessor);
 }
 
 void
 route_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_digits)
 {
+  route_run_mutation_hook();
   // First point in a route is always a new segment.
   // This improves compatibility when reading from
   // segment-unaware formats.
@@ -118,6 +131,7 @@ route_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_d
 void
 track_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_digits)
 {
+  track_run_mutation_hook();
   // First point in a track is always a new segment.
   // This improves compatibility when reading from
   // segment-unaware formats.
@@ -133,39 +147,57 @@ track_add_wpt(route_head* rte, Waypoint* wpt, QStringView namepart, int number_d
 void
 route_del_wpt(route_head* rte, Waypoint* wpt)
 {
+  route_run_mutation_hook();
   global_route_list->del_wpt(rte, wpt);
 }
 
 void
 track_del_wpt(route_head* rte, Waypoint* wpt)
 {
+  track_run_mutation_hook();
   global_track_list->del_wpt(rte, wpt);
 }
 
 void
 route_del_marked_wpts(route_head* rte)
 {
+  route_run_mutation_hook();
   global_route_list->del_marked_wpts(rte);
 }
 
 void
 track_del_marked_wpts(route_head* rte)
 {
+  track_run_mutation_hook();
   global_track_list->del_marked_wpts(rte);
 }
 
 void
 route_swap_wpts(route_head* rte, WaypointList& other)
 {
+  route_run_mutation_hook();
   global_route_list->swap_wpts(rte, other);
 }
 
 void
 track_swap_wpts(route_head* rte, WaypointList& other)
 {
+  track_run_mutation_hook();
   global_track_list->swap_wpts(rte, other);
 }
 
+void
+track_splice_wpts(route_head* rte, WaypointList& other)
+{
+  track_run_mutation_hook();
+  // First point in a track is always a new segment.
+  if (rte->waypoint_list.empty() && !other.empty()) {
+    other.front()->wpt_flags.new_trkseg = 1;
+  }
+
+  global_track_list->splice_wpts(rte, other);
+}
+
 void
 route_disp(const route_head* /* rh */, std::nullptr_t /* wc */)
 {
@@ -175,30 +207,36 @@ route_disp(const route_head* /* rh */, std::nullptr_t /* wc */)
 void
 route_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_cb wc)
 {
+  route_run_mutation_hook();
   global_route_list->common_disp_session(se, rh, rt, wc);
 }
 
 void
 track_disp_session(const session_t* se, route_hdr rh, route_trl rt, waypt_cb wc)
 {
+  track_run_mutation_hook();
   global_track_list->common_disp_session(se, rh, rt, wc);
 }
 
 void
 route_flush_all_routes()
 {
+  route_run_mutation_hook();
   global_route_list->flush();
 }
 
 void
 route_flush_all_tracks()
 {
+  track_run_mutation_hook();
   global_track_list->flush();
 }
 
 void
 route_deinit()
 {
+  route_mutation_hook = nullptr;
+  track_mutation_hook = nullptr;
   route_flush_all_routes();
   route_flush_all_tracks();
   delete global_route_list;
@@ -206,15 +244,17 @@ route_deinit()
 }
 
 void
-route_append(const RouteList* src)
+route_append(RouteList* src)
 {
-  src->copy(&global_route_list);
+  route_run_mutation_hook();
+  global_route_list->splice(*src);
 }
 
 void
-track_append(const RouteList* src)
+track_append(RouteList* src)
 {
-  src->copy(&global_track_list);
+  track_run_mutation_hook();
+  global_track_list->splice(*src);
 }
 
 void
@@ -226,15 +266,34 @@ route_backup(RouteList** head_bak)
 void
 route_restore(RouteList* head_bak)
 {
+  route_run_mutation_hook();
   global_route_list->restore(head_bak);
 }
 
 void
 route_swap(RouteList& other)
 {
+  route_run_mutation_hook();
   global_route_list->swap(other);
 }
 
+void
+route_set_mutation_hook(std::function<void()> hook)
+{
+  route_mutation_hook = std::move(hook);
+}
+
+void
+route_run_mutation_hook()
+{
+  if (route_mutation_hook) {
+    // Run it only once, the hook itself may read the list.
+    std::function<void()> hook = std::move(route_mutation_hook);
+    route_mutation_hook = nullptr;
+    hook();
+  }
+}
+
 void
 track_backup(RouteList** head_bak)
 {
@@ -244,24 +303,53 @@ track_backup(RouteList** head_bak)
 void
 track_restore(RouteList* head_bak)
 {
+  track_run_mutation_hook();
   global_track_list->restore(head_bak);
 }
 
 void
 track_swap(RouteList& other)
 {
+  track_run_mutation_hook();
   global_track_list->swap(other);
 }
 
+void
+track_set_mutation_hook(std::function<void()> hook)
+{
+  track_mutation_hook = std::move(hook);
+}
+
+void
+track_run_mutation_hook()
+{
+  if (track_mutation_hook) {
+    // Run it only once, the hook itself may read the list.
+    std::function<void()> hook = std::move(track_mutation_hook);
+    track_mutation_hook = nullptr;
+    hook();
+  }
+}
+
 /*
  * This really makes more sense for tracks than routes.
  * Run over all the trackpoints, computing heading (course), speed, and
  * and so on.
  *
- * return a collection of (hopefully interesting) statistics about the track.
+ * The results are cached on the track until its waypoint list changes,
+ * or until waypt_invalidate_computed() declares the points themselves
+ * may have been modified.
  */
-computed_trkdata track_recompute(const route_head* trk)
+static const route_head::computed_cache_t& track_computed(const route_head* trk)
 {
+  if (trk->computed &&
+      (trk->computed->generation == trk->waypoint_list.generation()) &&
+      (trk->computed->epoch == waypt_computed_epoch())) {
+    return *trk->computed;
+  }
+
+  auto cache = std::make_unique<route_head::computed_cache_t>();
+  cache->distance.reserve(trk->rte_waypt_ct());
   const Waypoint* prev = nullptr;
   int tkpt = 0;
   int pts_hrt = 0;
@@ -270,25 +358,44 @@ computed_trkdata track_recompute(const route_head* trk)
   double tot_cad = 0.0;
   int pts_pwr = 0;
   double tot_pwr = 0.0;
-  computed_trkdata tdata;
+  computed_trkdata& tdata = cache->data;
+
+  /*
+   * Compute the legs in one batch.
+   * gcdist and heading want radians, not degrees.
+   */
+  const int npts = trk->rte_waypt_ct();
+  std::vector<double> lat;
+  std::vector<double> lon;
+  lat.reserve(npts);
+  lon.reserve(npts);
+  bool need_course = false;
+  foreach (const Waypoint* wpt, trk->waypoint_list) {
+    lat.push_back(RAD(wpt->latitude));
+    lon.push_back(RAD(wpt->longitude));
+    if ((lat.size() > 1) && !wpt->course_has_value()) {
+      need_course = true;
+    }
+  }
+  std::vector<double> legs(npts);
+  gcdist_path(lat.data(), lon.data(), npts, legs.data());
+  std::vector<double> courses;
+  if (need_course) {
+    courses.resize(npts);
+    heading_true_degrees_path(lat.data(), lon.data(), npts, courses.data());
+  }
 
   foreach (Waypoint* thisw, trk->waypoint_list) {
 
     if (prev != nullptr) {
-      /*
-       * gcdist and heading want radians, not degrees.
-       */
-      double tlat = RAD(thisw->latitude);
-      double tlon = RAD(thisw->longitude);
-      double plat = RAD(prev->latitude);
-      double plon = RAD(prev->longitude);
       if (!thisw->course_has_value()) {
         // Only recompute course if the waypoint
         // didn't already have a course.
-        thisw->set_course(heading_true_degrees(plat, plon, tlat, tlon));
+        thisw->set_course(courses[tkpt - 1]);
       }
-      double dist = radtometers(gcdist(plat, plon, tlat, tlon));
+      double dist = radtometers(legs[tkpt - 1]);
       tdata.distance_meters += dist;
+      cache->distance.push_back(tdata.distance_meters);
 
       /*
        * If we've moved as much as a meter,
@@ -305,6 +412,8 @@ computed_trkdata track_recompute(const route_head* trk)
           thisw->set_speed(dist / timed);
         }
       }
+    } else {
+      cache->distance.push_back(0.0);
     }
 
     if (thisw->speed_has_value()) {
@@ -386,7 +495,29 @@ computed_trkdata track_recompute(const route_head* trk)
     tdata.avg_pwr = tot_pwr / pts_pwr;
   }
 
-  return tdata;
+  cache->generation = trk->waypoint_list.generation();
+  cache->epoch = waypt_computed_epoch();
+  trk->computed = std::move(cache);
+  return *trk->computed;
+}
+
+/*
+ * return a collection of (hopefully interesting) statistics about the track.
+ */
+computed_trkdata track_recompute(const route_head* trk)
+{
+  return track_computed(trk).data;
+}
+
+/*
+ * return the distance along the track between two of its points.
+ */
+double track_distance_meters(const route_head* trk, int from, int to)
+{
+  const std::vector<double>& distance = track_computed(trk).distance;
+  assert((from >= 0) && (from < static_cast<int>(distance.size())));
+  assert((to >= 0) && (to < static_cast<int>(distance.size())));
+  return distance[to] - distance[from];
 }
 
 route_head::route_head() :
@@ -457,26 +588,9 @@ RouteList::del_wpt(route_head* rte, Waypoint* wpt)
 void
 RouteList::del_marked_wpts(route_head* rte)
 {
-  // For lineary complexity build a new list from the points we keep.
-  WaypointList oldlist;
-  swap_wpts(rte, oldlist);
-
-  // mimic trkseg handling from WaypointList::del_rte_waypt
-  bool inherit_new_trkseg = false;
-  for (Waypoint* wpt : std::as_const(oldlist)) {
-    if (wpt->wpt_flags.marked_for_deletion) {
-      if (wpt->wpt_flags.new_trkseg) {
-        inherit_new_trkseg = true;
-      }
-      delete wpt;
-    } else {
-      if (inherit_new_trkseg) {
-        wpt->wpt_flags.new_trkseg = 1;
-        inherit_new_trkseg = false;
-      }
-      add_wpt(rte, wpt, false, u"RPT", 3);
-    }
-  }
+  const int old_ct = rte->rte_waypt_ct();
+  rte->waypoint_list.del_marked_rte_wpts();
+  waypt_ct -= old_ct - rte->rte_waypt_ct();
 }
 
 void
@@ -550,9 +664,25 @@ void RouteList::swap(RouteList& other)
   other = tmp_list;
 }
 
+void RouteList::splice(RouteList& other)
+{
+  append(other);
+  waypt_ct += other.waypt_ct;
+  other.clear();
+  other.waypt_ct = 0;
+}
+
 void RouteList::swap_wpts(route_head* rte, WaypointList& other)
 {
   this->waypt_ct -= rte->rte_waypt_ct();
   this->waypt_ct += other.count();
   rte->waypoint_list.swap(other);
 }
+
+// Moves all the points of other to the end of rte, leaving other empty.
+// Unlike add_wpt no names are synthesized.
+void RouteList::splice_wpts(route_head* rte, WaypointList& other)
+{
+  this->waypt_ct += other.count();
+  rte->waypoint_list.splice(other);
+}
@@ -54,28 +54,121 @@
     History:
 
 	2008/08/20: added "relative" option, (Carsten Allefeld, carsten.allefeld@googlemail.com)
+	2026/10/18: added "visvalingam" and "douglaspeucker" options, indexed heap.
 */
 
-#include <cassert>
+#include <algorithm>            // for stable_sort, max
+#include <cmath>                // for sqrt, sin, cos
 #include <cstdlib>              // for strtol
-#include <iterator>             // for prev
+#include <limits>               // for numeric_limits
+#include <queue>                // for priority_queue
+#include <vector>               // for vector
 
 #include <QDateTime>            // for QDateTime
-#include <QHash>                // for QHash
-#include <QMap>                 // for QMap
+#include <QThreadPool>          // for QThreadPool
 
 #include "defs.h"
 #include "smplrout.h"
-#include "grtcirc.h"            // for gcdist, linedist, radtometers, radtomiles, linepart
+#include "grtcirc.h"            // for gcdist, linedist, radtometers, radtomiles, linepart, RAD
 #include "src/core/datetime.h"  // for DateTime
 
 
 #if FILTERS_ENABLED
 #define MYNAME "simplify"
 
-inline bool operator<(const SimplifyRouteFilter::trackerror& lhs, const SimplifyRouteFilter::trackerror& rhs)
+void SimplifyRouteFilter::ErrorHeap::build()
 {
-  return ((lhs.dist > rhs.dist) || ((lhs.dist == rhs.dist) && (lhs.wptpos < rhs.wptpos)));
+  const int n = err_.size();
+  heap_.resize(n);
+  pos_.resize(n);
+  for (int i = 0; i < n; ++i) {
+    place(i, i);
+  }
+  for (int i = n / 2 - 1; i >= 0; --i) {
+    sift_down(i);
+  }
+}
+
+void SimplifyRouteFilter::ErrorHeap::pop()
+{
+  pos_[heap_.front()] = -1;
+  const int idx = heap_.back();
+  heap_.pop_back();
+  if (!heap_.empty()) {
+    place(0, idx);
+    sift_down(0);
+  }
+}
+
+void SimplifyRouteFilter::ErrorHeap::update(int idx)
+{
+  const int pos = pos_[idx];
+  if (pos < 0) {
+    return;
+  }
+  sift_up(pos);
+  sift_down(pos_[idx]);
+}
+
+void SimplifyRouteFilter::ErrorHeap::sift_up(int pos)
+{
+  const int idx = heap_[pos];
+  while (pos > 0) {
+    const int parent = (pos - 1) / 2;
+    if (!before(idx, heap_[parent])) {
+      break;
+    }
+    place(pos, heap_[parent]);
+    pos = parent;
+  }
+  place(pos, idx);
+}
+
+void SimplifyRouteFilter::ErrorHeap::sift_down(int pos)
+{
+  const int n = heap_.size();
+  const int idx = heap_[pos];
+  for (;;) {
+    int child = 2 * pos + 1;
+    if (child >= n) {
+      break;
+    }
+    if ((child + 1 < n) && before(heap_[child + 1], heap_[child])) {
+      ++child;
+    }
+    if (!before(heap_[child], idx)) {
+      break;
+    }
+    place(pos, heap_[child]);
+    pos = child;
+  }
+  place(pos, idx);
+}
+
+double SimplifyRouteFilter::compute_area_error(const neighborhood& nb) const
+{
+  /* Area of the triangle between the unit vectors, which for the short
+   * legs of a track is the spherical area to well within our needs. */
+  auto to_vec = [](const Waypoint* w, double* v)->void {
+    const double lat = RAD(w->latitude);
+    const double lon = RAD(w->longitude);
+    v[0] = cos(lon) * cos(lat);
+    v[1] = sin(lat);
+    v[2] = sin(lon) * cos(lat);
+  };
+  double a[3], b[3], c[3];
+  to_vec(nb.prev, a);
+  to_vec(nb.wpt, b);
+  to_vec(nb.next, c);
+  const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  const double x = u[1] * v[2] - u[2] * v[1];
+  const double y = u[2] * v[0] - u[0] * v[2];
+  const double z = u[0] * v[1] - u[1] * v[0];
+  const double area = 0.5 * sqrt(x * x + y * y + z * z);
+
+  /* report the side of the square with the same area */
+  return radtomiles(sqrt(area));
 }
 
 double SimplifyRouteFilter::compute_track_error(const neighborhood& nb) const
@@ -110,6 +203,9 @@ double SimplifyRouteFilter::compute_track_error(const neighborhood& nb) const
                     gcdist(wpt1->latitude, wpt1->longitude,
                            wpt2->latitude, wpt2->longitude));
     break;
+  case metric_t::area:
+    track_error = compute_area_error(nb);
+    break;
   case metric_t::relative:
   default: // eliminate false positive warning with g++ 11.3.0: ‘error’ may be used uninitialized in this function [-Wmaybe-uninitialized]
     // if timestamps exist, distance to interpolated point
@@ -140,111 +236,93 @@ double SimplifyRouteFilter::compute_track_error(const neighborhood& nb) const
   return track_error;
 }
 
-void SimplifyRouteFilter::routesimple_head(const route_head* rte)
+bool SimplifyRouteFilter::needs_simplify(const route_head* rte) const
 {
   /* short-circuit if we already have fewer than the max points */
   if ((limit_basis == limit_basis_t::count) && count >= rte->rte_waypt_ct()) {
-    return;
+    return false;
   }
 
   /* short-circuit if the route is impossible to simplify, too. */
   if (2 >= rte->rte_waypt_ct()) {
-    return;
+    return false;
   }
 
-  /* compute all distances */
-  /* sort XTE array, lowest XTE last */
-  Waypoint* pwpt = nullptr;
-  Waypoint* ppwpt = nullptr;
-  WaypointList::size_type pos = 0;
-  neighborhood nb;
-  trackerror te;
-  QMap<trackerror, neighborhood> errormap;
-  QHash<Waypoint*, trackerror> wpthash;
-  for (auto* wpt : rte->waypoint_list) {
-    wpt->extra_data = nullptr;
-
-    if (metric == metric_t::relative) {
-      // check hdop is available for compute_track_error
-      if (wpt->hdop == 0) {
-        fatal(MYNAME ": relative needs hdop information.\n");
-      }
-    }
-
-    if (pwpt != nullptr) {
-      nb.wpt = pwpt;
-      nb.prev = ppwpt;
-      nb.next = wpt;
-
-      te.dist = compute_track_error(nb);
-      te.wptpos = pos;
+  return true;
+}
 
-      errormap.insert(te, nb);
-      wpthash.insert(pwpt, te);
-    }
+void SimplifyRouteFilter::routesimple_elimination(const std::vector<Waypoint*>& pts) const
+{
+  const int n = pts.size();
+  std::vector<int> prev(n);
+  std::vector<int> next(n);
+  std::vector<double> err(n);
+
+  auto error_at = [this, &pts, &prev, &next](int i)->double {
+    neighborhood nb;
+    nb.wpt = pts[i];
+    nb.prev = (prev[i] < 0) ? nullptr : pts[prev[i]];
+    nb.next = (next[i] < 0) ? nullptr : pts[next[i]];
+    return compute_track_error(nb);
+  };
 
-    ppwpt = pwpt;
-    pwpt = wpt;
-    ++pos;
+  /* compute all distances */
+  for (int i = 0; i < n; ++i) {
+    prev[i] = i - 1;
+    next[i] = (i + 1 < n) ? i + 1 : -1;
+  }
+  for (int i = 0; i < n; ++i) {
+    err[i] = error_at(i);
   }
-  nb.wpt = pwpt;
-  nb.prev = ppwpt;
-  nb.next = nullptr;
-
-  te.dist = compute_track_error(nb);
-  te.wptpos = pos;
-
-  errormap.insert(te, nb);
-  wpthash.insert(pwpt, te);
 
-  assert(!errormap.isEmpty());
-  double totalerror = errormap.lastKey().dist;
+  /* lowest error on top */
+  ErrorHeap heap(err);
+  heap.build();
+  double totalerror = err[heap.top()];
 
   /* while we still have too many records... */
-  while ((!errormap.isEmpty()) &&
-         (((limit_basis == limit_basis_t::count) && (count < errormap.size())) ||
+  while ((!heap.empty()) &&
+         (((limit_basis == limit_basis_t::count) && (count < heap.size())) ||
           ((limit_basis == limit_basis_t::error) && (totalerror < error)))) {
 
-    /* remove the record with the lowest XTE */
-    neighborhood goner = errormap.last();
-    goner.wpt->wpt_flags.marked_for_deletion = 1;
-    // errormap.remove(lastKey());  // with Qt 5.12.12, 5.15.2 results in asan heap-use-after-free errors in build_extra_tests.sh
-    errormap.erase(std::prev(errormap.end())); // in Qt6 can use cend().
-    // wpthash.remove(goner.wpt); // removal not necessary
-
-    /* recompute neighbors of point marked for deletion. */
-    if (goner.prev != nullptr) {
-      assert(wpthash.contains(goner.prev));
-      trackerror terr = wpthash.value(goner.prev);
-      assert(errormap.contains(terr));
-      neighborhood nbh = errormap.value(terr);
-      nbh.next = goner.next;
-      errormap.remove(terr);
-      terr.dist = compute_track_error(nbh);
-      errormap.insert(terr, nbh);
-      wpthash.insert(goner.prev, terr);
+    /* remove the record with the lowest error */
+    const int goner = heap.top();
+    const double goner_err = err[goner];
+    pts[goner]->wpt_flags.marked_for_deletion = 1;
+    heap.pop();
+
+    /* recompute neighbors of point marked for deletion.  The effective
+     * area of Visvalingam-Whyatt never drops below that of a point
+     * already eliminated. */
+    const int p = prev[goner];
+    const int q = next[goner];
+    if (p >= 0) {
+      next[p] = q;
+      err[p] = error_at(p);
+      if (metric == metric_t::area) {
+        err[p] = std::max(err[p], goner_err);
+      }
+      heap.update(p);
     }
-    if (goner.next != nullptr) {
-      assert(wpthash.contains(goner.next));
-      trackerror terr = wpthash.value(goner.next);
-      assert(errormap.contains(terr));
-      neighborhood nbh = errormap.value(terr);
-      nbh.prev = goner.prev;
-      errormap.remove(terr);
-      terr.dist = compute_track_error(nbh);
-      errormap.insert(terr, nbh);
-      wpthash.insert(goner.next, terr);
+    if (q >= 0) {
+      prev[q] = p;
+      err[q] = error_at(q);
+      if (metric == metric_t::area) {
+        err[q] = std::max(err[q], goner_err);
+      }
+      heap.update(q);
     }
 
     /* compute impact of deleting next point */
-    if (limit_basis == limit_basis_t::error) {
+    if ((limit_basis == limit_basis_t::error) && !heap.empty()) {
       switch (metric) {
       case metric_t::crosstrack:
       case metric_t::relative:
-        totalerror = errormap.lastKey().dist;
+      case metric_t::area:
+        totalerror = err[heap.top()];
         break;
       case metric_t::length:
-        totalerror += errormap.lastKey().dist;
+        totalerror += err[heap.top()];
         break;
       }
     }
@@ -252,21 +330,143 @@ void SimplifyRouteFilter::routesimple_head(const route_head* rte)
   } /* end of too many records loop */
 }
 
+SimplifyRouteFilter::dp_segment_t
+SimplifyRouteFilter::dp_farthest(const std::vector<Waypoint*>& pts, int first, int last) const
+{
+  dp_segment_t seg{std::numeric_limits<double>::lowest(), first, last, -1};
+  neighborhood nb;
+  nb.prev = pts[first];
+  nb.next = pts[last];
+  for (int i = first + 1; i < last; ++i) {
+    nb.wpt = pts[i];
+    double dist = compute_track_error(nb);
+    if (dist > seg.dist) {
+      seg.dist = dist;
+      seg.split = i;
+    }
+  }
+  return seg;
+}
+
+void SimplifyRouteFilter::routesimple_douglas_peucker(const std::vector<Waypoint*>& pts) const
+{
+  const int n = pts.size();
+  std::vector<bool> keep(n, false);
+  keep[0] = true;
+  keep[n - 1] = true;
+  int kept = 2;
+
+  /* refine the segment with the largest error first, so a point count
+   * limit keeps the most significant points. */
+  auto lower = [](const dp_segment_t& lhs, const dp_segment_t& rhs)->bool {
+    return (lhs.dist < rhs.dist) || ((lhs.dist == rhs.dist) && (lhs.first > rhs.first));
+  };
+  std::priority_queue<dp_segment_t, std::vector<dp_segment_t>, decltype(lower)> segments(lower);
+  auto add_segment = [this, &pts, &segments](int first, int last)->void {
+    if (last - first > 1) {
+      dp_segment_t seg = dp_farthest(pts, first, last);
+      if (seg.split >= 0) {
+        segments.push(seg);
+      }
+    }
+  };
+
+  add_segment(0, n - 1);
+  while (!segments.empty()) {
+    const dp_segment_t seg = segments.top();
+    if ((limit_basis == limit_basis_t::count) ? (kept >= count) : (seg.dist < error)) {
+      break;
+    }
+    segments.pop();
+    keep[seg.split] = true;
+    ++kept;
+    add_segment(seg.first, seg.split);
+    add_segment(seg.split, seg.last);
+  }
+
+  /* like elimination, a count of one keeps only the first point and a
+   * count of zero removes them all. */
+  if (limit_basis == limit_basis_t::count) {
+    if (count < 2) {
+      keep[n - 1] = false;
+    }
+    if (count < 1) {
+      keep[0] = false;
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (!keep[i]) {
+      pts[i]->wpt_flags.marked_for_deletion = 1;
+    }
+  }
+}
+
+void SimplifyRouteFilter::routesimple_head(const route_head* rte) const
+{
+  std::vector<Waypoint*> pts;
+  pts.reserve(rte->rte_waypt_ct());
+  for (auto* wpt : rte->waypoint_list) {
+    pts.push_back(wpt);
+  }
+
+  switch (algorithm) {
+  case algorithm_t::elimination:
+    routesimple_elimination(pts);
+    break;
+  case algorithm_t::douglas_peucker:
+    routesimple_douglas_peucker(pts);
+    break;
+  }
+}
+
 void SimplifyRouteFilter::process()
 {
-  auto common_head_lambda = [this](const route_head* rte)->void {
-    routesimple_head(rte);
+  std::vector<const route_head*> heads;
+  auto collect_lambda = [this, &heads](const route_head* rte)->void {
+    if (!needs_simplify(rte)) {
+      return;
+    }
+    if (metric == metric_t::relative) {
+      // check hdop is available for compute_track_error
+      for (const auto* wpt : rte->waypoint_list) {
+        if (wpt->hdop == 0) {
+          fatal(MYNAME ": relative needs hdop information.\n");
+        }
+      }
+    }
+    heads.push_back(rte);
   };
+  route_disp_all(collect_lambda, nullptr, nullptr);
+  track_disp_all(collect_lambda, nullptr, nullptr);
+
+  /* Routes and tracks own disjoint waypoints, so they can be simplified
+   * concurrently.  Start the longest ones first. */
+  if (heads.size() > 1) {
+    std::stable_sort(heads.begin(), heads.end(),
+    [](const route_head* a, const route_head* b)->bool {
+      return a->rte_waypt_ct() > b->rte_waypt_ct();
+    });
+    QThreadPool pool;
+    for (const auto* rte : heads) {
+      pool.start([this, rte]() {
+        routesimple_head(rte);
+      });
+    }
+    pool.waitForDone();
+  } else if (!heads.empty()) {
+    routesimple_head(heads.front());
+  }
 
   auto route_tail_lambda = [](const route_head* rte)->void {
     route_del_marked_wpts(const_cast<route_head*>(rte));
   };
-  route_disp_all(common_head_lambda, route_tail_lambda, nullptr);
+  route_disp_all(nullptr, route_tail_lambda, nullptr);
 
   auto track_tail_lambda = [](const route_head* rte)->void {
     track_del_marked_wpts(const_cast<route_head*>(rte));
   };
-  track_disp_all(common_head_lambda, track_tail_lambda, nullptr);
+  track_disp_all(nullptr, track_tail_lambda, nullptr);
 }
 
 void SimplifyRouteFilter::init()
@@ -281,14 +481,25 @@ void SimplifyRouteFilter::init()
     fatal(MYNAME ": You must specify either count or error, but not both.\n");
   }
 
-  if (!lenopt && !relopt) {
+  if (!lenopt && !relopt && !vwopt) {
     metric = metric_t::crosstrack; /* default */
-  } else if (!xteopt && lenopt && !relopt) {
+  } else if (!xteopt && lenopt && !relopt && !vwopt) {
     metric = metric_t::length;
-  } else if (!xteopt && !lenopt && relopt) {
+  } else if (!xteopt && !lenopt && relopt && !vwopt) {
     metric = metric_t::relative;
+  } else if (!xteopt && !lenopt && !relopt && vwopt) {
+    metric = metric_t::area;
+  } else {
+    fatal(MYNAME ": You may specify only one of crosstrack, length, relative, or visvalingam.\n");
+  }
+
+  if (dpopt) {
+    if (metric == metric_t::area) {
+      fatal(MYNAME ": The visvalingam and douglaspeucker options are incompatible.\n");
+    }
+    algorithm = algorithm_t::douglas_peucker;
   } else {
-    fatal(MYNAME ": You may specify only one of crosstrack, length, or relative.\n");
+    algorithm = algorithm_t::elimination;
   }
 
   switch (limit_basis) {
@@ -54,11 +54,14 @@
     History:
 
 	2008/08/20: added "relative" option, (Carsten Allefeld, carsten.allefeld@googlemail.com)
+	2026/10/18: added "visvalingam" and "douglaspeucker" options, indexed heap.
 */
 
 #ifndef SMPLROUT_H_INCLUDED_
 #define SMPLROUT_H_INCLUDED_
 
+#include <vector>                // for vector
+
 #include <QString>               // for QString
 #include <QStringView>           // for QStringView
 #include <QVector>               // for QVector
@@ -73,13 +76,6 @@ class SimplifyRouteFilter:public Filter
 {
 public:
 
-  /* Types */
-
-  struct trackerror {
-    double dist;
-    WaypointList::size_type wptpos;
-  };
-
   /* Member Functions */
 
   QVector<arglist_t>* get_args() override
@@ -94,12 +90,65 @@ private:
   /* Types */
 
   enum class limit_basis_t {count, error};
-  enum class metric_t {crosstrack, length, relative};
+  enum class metric_t {crosstrack, length, relative, area};
+  enum class algorithm_t {elimination, douglas_peucker};
 
   struct neighborhood {
-    Waypoint* wpt;
-    Waypoint* prev;
-    Waypoint* next;
+    const Waypoint* wpt;
+    const Waypoint* prev;
+    const Waypoint* next;
+  };
+
+  /*
+   * Binary min-heap of point indices ordered by their error, lowest
+   * error first and the later point first among equal errors.  The heap
+   * position of every point is kept so that a key can be updated in place.
+   */
+  class ErrorHeap
+  {
+  public:
+    explicit ErrorHeap(const std::vector<double>& err) : err_(err) {}
+
+    void build();
+    bool empty() const
+    {
+      return heap_.empty();
+    }
+    int size() const
+    {
+      return heap_.size();
+    }
+    int top() const
+    {
+      return heap_.front();
+    }
+    void pop();
+    void update(int idx);
+
+  private:
+    bool before(int a, int b) const
+    {
+      return (err_[a] < err_[b]) || ((err_[a] == err_[b]) && (a > b));
+    }
+    void place(int pos, int idx)
+    {
+      heap_[pos] = idx;
+      pos_[idx] = pos;
+    }
+    void sift_up(int pos);
+    void sift_down(int pos);
+
+    const std::vector<double>& err_;
+    std::vector<int> heap_;
+    std::vector<int> pos_;
+  };
+
+  /* A Douglas-Peucker segment and the interior point farthest from it. */
+  struct dp_segment_t {
+    double dist;
+    int first;
+    int last;
+    int split;
   };
 
   /* Constants */
@@ -109,7 +158,12 @@ private:
   /* Member Functions */
 
   double compute_track_error(const neighborhood& nb) const;
-  void routesimple_head(const route_head* rte);
+  double compute_area_error(const neighborhood& nb) const;
+  bool needs_simplify(const route_head* rte) const;
+  void routesimple_head(const route_head* rte) const;
+  void routesimple_elimination(const std::vector<Waypoint*>& pts) const;
+  void routesimple_douglas_peucker(const std::vector<Waypoint*>& pts) const;
+  dp_segment_t dp_farthest(const std::vector<Waypoint*>& pts, int first, int last) const;
 
   /* Data Members */
 
@@ -117,12 +171,15 @@ private:
   double error = 0;
   limit_basis_t limit_basis{limit_basis_t::error};
   metric_t metric{metric_t::crosstrack};
+  algorithm_t algorithm{algorithm_t::elimination};
 
   char* countopt = nullptr;
   char* erroropt = nullptr;
   char* xteopt = nullptr;
   char* lenopt = nullptr;
   char* relopt = nullptr;
+  char* vwopt = nullptr;
+  char* dpopt = nullptr;
 
   QVector<arglist_t> args = {
     {
@@ -143,8 +200,16 @@ private:
     },
     {
       "relative", &relopt, "Use relative error", nullptr,
+      ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
+    {
+      "visvalingam", &vwopt, "Use triangle area (Visvalingam-Whyatt)", nullptr,
       ARGTYPE_BOOL | ARGTYPE_END_EXCL, ARG_NOMINMAX, nullptr
     },
+    {
+      "douglaspeucker", &dpopt, "Use Douglas-Peucker splitting", nullptr,
+      ARGTYPE_BOOL, ARG_NOMINMAX, nullptr
+    },
   };
 
 };
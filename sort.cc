@@ -21,8 +21,11 @@
 
 #include "sort.h"
 
+#include <limits>               // for numeric_limits
+
 #include <QDateTime>            // for QDateTime
 #include <QString>              // for operator<, QString
+#include <QtGlobal>             // for qint64
 
 #include "defs.h"
 #include "geocache.h"           // for Geocache
@@ -33,24 +36,26 @@
 #define MYNAME "sort"
 
 
-bool SortFilter::sort_comp_wpt_by_description(const Waypoint* a, const Waypoint* b)
+QString SortFilter::sort_key_wpt_by_description(const Waypoint* wpt)
 {
-  return a->description < b->description;
+  return wpt->description;
 }
 
-bool SortFilter::sort_comp_wpt_by_gcid(const Waypoint* a, const Waypoint* b)
+qint64 SortFilter::sort_key_wpt_by_gcid(const Waypoint* wpt)
 {
-  return a->gc_data->id < b->gc_data->id;
+  return wpt->gc_data->id;
 }
 
-bool SortFilter::sort_comp_wpt_by_shortname(const Waypoint* a, const Waypoint* b)
+QString SortFilter::sort_key_wpt_by_shortname(const Waypoint* wpt)
 {
-  return a->shortname < b->shortname;
+  return wpt->shortname;
 }
 
-bool SortFilter::sort_comp_wpt_by_time(const Waypoint* a, const Waypoint* b)
+/* Invalid times sort before all valid ones, as QDateTime orders them. */
+qint64 SortFilter::sort_key_wpt_by_time(const Waypoint* wpt)
 {
-  return a->GetCreationTime() < b->GetCreationTime();
+  const gpsbabel::DateTime t = wpt->GetCreationTime();
+  return t.isValid() ? t.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
 }
 
 bool SortFilter::sort_comp_rh_by_description(const route_head* a, const route_head* b)
@@ -74,16 +79,16 @@ void SortFilter::process()
   case SortModeWpt::none:
     break;
   case SortModeWpt::description:
-    waypt_sort(sort_comp_wpt_by_description);
+    waypt_sort_by_key(sort_key_wpt_by_description);
     break;
   case SortModeWpt::gcid:
-    waypt_sort(sort_comp_wpt_by_gcid);
+    waypt_sort_by_key(sort_key_wpt_by_gcid);
     break;
   case SortModeWpt::shortname:
-    waypt_sort(sort_comp_wpt_by_shortname);
+    waypt_sort_by_key(sort_key_wpt_by_shortname);
     break;
   case SortModeWpt::time:
-    waypt_sort(sort_comp_wpt_by_time);
+    waypt_sort_by_key(sort_key_wpt_by_time);
     break;
   default:
     fatal(MYNAME ": unknown waypoint sort mode.");
@@ -24,6 +24,7 @@
 
 #include <QString>   // for QString
 #include <QVector>   // for QVector
+#include <QtGlobal>  // for qint64
 
 #include "defs.h"    // for arglist_t, ARGTYPE_BOOL, ARG_NOMINMAX, Waypoint
 #include "filter.h"  // for Filter
@@ -65,10 +66,10 @@ private:
 
   /* Member Functions */
 
-  static bool sort_comp_wpt_by_description(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_gcid(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_shortname(const Waypoint* a, const Waypoint* b);
-  static bool sort_comp_wpt_by_time(const Waypoint* a, const Waypoint* b);
+  static QString sort_key_wpt_by_description(const Waypoint* wpt);
+  static qint64 sort_key_wpt_by_gcid(const Waypoint* wpt);
+  static QString sort_key_wpt_by_shortname(const Waypoint* wpt);
+  static qint64 sort_key_wpt_by_time(const Waypoint* wpt);
   static bool sort_comp_rh_by_description(const route_head* a, const route_head* b);
   static bool sort_comp_rh_by_name(const route_head* a, const route_head* b);
   static bool sort_comp_rh_by_number(const route_head* a, const route_head* b);
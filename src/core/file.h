@@ -26,6 +26,7 @@
 #include <QIODevice>
 #include <cstdio>
 #include "src/core/logging.h"
+#include "src/core/perfstats.h"
 #include "defs.h"
 
 // Mimic gbfile open services
@@ -66,6 +67,23 @@ public:
     return status;
   }
 
+protected:
+  qint64 readData(char* data, qint64 maxSize) override {
+    qint64 n = QFile::readData(data, maxSize);
+    if (n > 0) {
+      PerfStats::count_read(n);
+    }
+    return n;
+  }
+
+  qint64 writeData(const char* data, qint64 maxSize) override {
+    qint64 n = QFile::writeData(data, maxSize);
+    if (n > 0) {
+      PerfStats::count_written(n);
+    }
+    return n;
+  }
+
 };
 
 } // namespace gpsbabel
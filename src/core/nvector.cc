@@ -447,4 +447,50 @@ PVector::PVector(const Vector3D& v)
   z_ = v.getz();
 }
 
+NVectorArray::NVectorArray(const WaypointList& list)
+{
+  xyz_.resize(3 * list.count());
+  double* v = xyz_.data();
+  for (const Waypoint* wpt : list) {
+    unit(wpt->latitude, wpt->longitude, v);
+    v += 3;
+  }
+}
+
+void NVectorArray::unit(double latitude_degrees, double longitude_degrees, double* v)
+{
+  // Same frame as NVector(latitude_degrees, longitude_degrees).
+  double latitude_radians = latitude_degrees * kRadiansPerDegree;
+  double longitude_radians = longitude_degrees * kRadiansPerDegree;
+  double coslat = cos(latitude_radians);
+  v[0] = sin(latitude_radians);
+  v[1] = sin(longitude_radians)*coslat;
+  v[2] = -cos(longitude_radians)*coslat;
+}
+
+NVectorArray::ChordBand NVectorArray::band(double radians)
+{
+  ChordBand result;
+  if (radians < 0.0) {
+    /* no pair is within a negative arc */
+    result.below2 = -1.0;
+    result.above2 = -1.0;
+    return result;
+  }
+  if (!(radians <= M_PI)) {
+    /* every pair is closer than more than a half circle */
+    result.below2 = std::isnan(radians) ? 0.0 : HUGE_VAL;
+    result.above2 = HUGE_VAL;
+    return result;
+  }
+  // The components carry errors of a few ulps, so the chord of two
+  // points is within a small absolute error of 2*sin(arc/2).
+  double chord = 2.0 * sin(0.5 * radians);
+  double below = chord * (1.0 - kTolerance) - kTolerance;
+  double above = chord * (1.0 + kTolerance) + kTolerance;
+  result.below2 = (below > 0.0) ? below * below : -1.0;
+  result.above2 = above * above;
+  return result;
+}
+
 } // namespace gpsbabel
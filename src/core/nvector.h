@@ -20,6 +20,10 @@
 #ifndef NVECTOR_H
 #define NVECTOR_H
 
+#include <vector>
+
+#include <QtGlobal>
+
 #include "defs.h"
 #include "vector3d.h"
 
@@ -93,5 +97,55 @@ public:
   [[nodiscard]] std::pair<NVector, double> toNVectorAndHeight() const;
 };
 
+/*
+ * The unit n-vectors of a list of points, stored contiguously as x, y, z
+ * triples.  Distance tests against a fixed arc can then compare squared
+ * chord lengths instead of evaluating trig for every pair.
+ * Obtain one with WaypointList::nvectors().
+ */
+class NVectorArray
+{
+public:
+  /* Squared chords bracketing an arc with room for rounding.  A pair
+   * closer than below2 is certainly within the arc, one farther than
+   * above2 certainly beyond it; anything else needs an exact test. */
+  struct ChordBand {
+    double below2;
+    double above2;
+  };
+
+  explicit NVectorArray(const WaypointList& list);
+
+  [[nodiscard]] int size() const
+  {
+    return xyz_.size() / 3;
+  }
+  [[nodiscard]] const double* at(int i) const
+  {
+    return &xyz_[3 * i];
+  }
+  [[nodiscard]] double chord2(int i, int j) const
+  {
+    return chord2(at(i), at(j));
+  }
+  static double chord2(const double* a, const double* b)
+  {
+    const double dx = a[0] - b[0];
+    const double dy = a[1] - b[1];
+    const double dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+  }
+  static void unit(double latitude_degrees, double longitude_degrees, double* v);
+  static ChordBand band(double radians);
+
+  quint64 generation{0};
+  quint64 epoch{0};
+
+private:
+  static constexpr double kTolerance = 1.0e-9;
+
+  std::vector<double> xyz_;
+};
+
 } // namespace gpsbabel
 #endif // NVECTOR_H
@@ -0,0 +1,95 @@
+/*
+    Stable sort that spreads large inputs over a thread pool.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef PARALLELSORT_H_INCLUDED_
+#define PARALLELSORT_H_INCLUDED_
+
+#include <algorithm>    // for stable_sort, merge
+#include <cstddef>      // for size_t
+#include <iterator>     // for make_move_iterator
+#include <utility>      // for swap
+#include <vector>       // for vector
+
+#include <QThread>      // for QThread
+#include <QThreadPool>  // for QThreadPool
+
+namespace gpsbabel
+{
+
+/*
+ * Same result as std::stable_sort.  Large inputs are cut into a power of
+ * two number of runs that are sorted concurrently, then merged pairwise,
+ * each pass of merges also running concurrently.  Merging takes from the
+ * left run on ties, which keeps the sort stable.
+ */
+template <typename T, typename Compare>
+void parallel_stable_sort(std::vector<T>& v, Compare comp)
+{
+  constexpr std::size_t kMinRun = 32 * 1024;
+
+  const std::size_t n = v.size();
+  const int threads = QThread::idealThreadCount();
+  std::size_t runs = 1;
+  while ((runs < static_cast<std::size_t>(threads)) && (n / (2 * runs) >= kMinRun)) {
+    runs *= 2;
+  }
+  if (runs == 1) {
+    std::stable_sort(v.begin(), v.end(), comp);
+    return;
+  }
+
+  std::vector<std::size_t> bounds(runs + 1);
+  for (std::size_t i = 0; i <= runs; ++i) {
+    bounds[i] = n * i / runs;
+  }
+
+  QThreadPool pool;
+  for (std::size_t i = 0; i < runs; ++i) {
+    pool.start([&v, &bounds, comp, i]() {
+      std::stable_sort(v.begin() + bounds[i], v.begin() + bounds[i + 1], comp);
+    });
+  }
+  pool.waitForDone();
+
+  std::vector<T> buffer(n);
+  std::vector<T>* src = &v;
+  std::vector<T>* dst = &buffer;
+  for (std::size_t width = 1; width < runs; width *= 2) {
+    for (std::size_t i = 0; i < runs; i += 2 * width) {
+      pool.start([src, dst, &bounds, comp, i, width]() {
+        auto first = src->begin();
+        std::merge(std::make_move_iterator(first + bounds[i]),
+                   std::make_move_iterator(first + bounds[i + width]),
+                   std::make_move_iterator(first + bounds[i + width]),
+                   std::make_move_iterator(first + bounds[i + 2 * width]),
+                   dst->begin() + bounds[i], comp);
+      });
+    }
+    pool.waitForDone();
+    std::swap(src, dst);
+  }
+  if (src != &v) {
+    v.swap(buffer);
+  }
+}
+
+} // namespace gpsbabel
+#endif // PARALLELSORT_H_INCLUDED_
@@ -0,0 +1,208 @@
+/*
+    Measurements of the readers, filters and writers of a run.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#include <utility>               // for as_const
+#ifdef GPSBABEL_COUNT_ALLOCATIONS
+#include <cstdlib>               // for free, malloc
+#include <new>                   // for bad_alloc, get_new_handler, new_handler
+#endif
+
+#if __WIN32__
+#include <windows.h>             // for FILETIME, GetCurrentProcess, GetProcessTimes
+#include <psapi.h>               // for GetProcessMemoryInfo, PROCESS_MEMORY_COUNTERS
+#else
+#include <sys/resource.h>        // for getrusage, rusage, RUSAGE_SELF
+#endif
+
+#include <QIODevice>             // for QIODevice
+#include <QJsonArray>            // for QJsonArray
+#include <QJsonDocument>         // for QJsonDocument, QJsonDocument::Indented
+#include <QJsonObject>           // for QJsonObject
+
+#include "defs.h"                // for route_waypt_count, track_waypt_count, waypt_count, gpsbabel_version
+#include "src/core/file.h"       // for File
+#include "src/core/perfstats.h"
+
+
+namespace gpsbabel
+{
+
+PerfStats::Phase::Phase(const QString& kind, const QString& name, const QString& fname) :
+  active_(enabled())
+{
+  if (active_) {
+    kind_ = kind;
+    name_ = name;
+    fname_ = fname;
+    start_ = current_usage();
+    timer_.start();
+  }
+}
+
+PerfStats::Phase::~Phase()
+{
+  if (active_) {
+    double wall_sec = timer_.nsecsElapsed() / 1.0e9;
+    phases_.append({kind_, name_, fname_, wall_sec, start_, current_usage()});
+  }
+}
+
+PerfStats::Phase::usage_t PerfStats::Phase::current_usage()
+{
+  usage_t usage;
+
+#if __WIN32__
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+    auto to_usec = [](const FILETIME& ft)->qint64 {
+      return ((static_cast<qint64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10;
+    };
+    usage.cpu_usec = to_usec(kernel_time) + to_usec(user_time);
+  }
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    usage.peak_rss_kb = counters.PeakWorkingSetSize / 1024;
+  }
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+    usage.cpu_usec = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+                     ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#ifdef __APPLE__
+    usage.peak_rss_kb = ru.ru_maxrss / 1024;	/* bytes */
+#else
+    usage.peak_rss_kb = ru.ru_maxrss;		/* kilobytes */
+#endif
+  }
+#endif
+
+  usage.points = waypt_count() + route_waypt_count() + track_waypt_count();
+  usage.allocations = allocations_.load(std::memory_order_relaxed);
+  usage.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+  usage.bytes_read = bytes_read_.load(std::memory_order_relaxed);
+  usage.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+  return usage;
+}
+
+void PerfStats::enable(const QString& report_fname)
+{
+  report_fname_ = report_fname;
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void PerfStats::write_report()
+{
+  if (!enabled()) {
+    return;
+  }
+  enabled_.store(false, std::memory_order_relaxed);
+
+  QJsonArray phases;
+  double total_wall_sec = 0.0;
+  qint64 total_cpu_usec = 0;
+  for (const auto& phase : std::as_const(phases_)) {
+    /* readers produce points, filters and writers consume them. */
+    qint64 points = (phase.kind == "reader") ? phase.end.points - phase.start.points : phase.start.points;
+    QJsonObject obj{
+      {"kind", phase.kind},
+      {"name", phase.name},
+      {"file", phase.fname},
+      {"wall_sec", phase.wall_sec},
+      {"cpu_sec", (phase.end.cpu_usec - phase.start.cpu_usec) / 1.0e6},
+      {"peak_rss_delta_kb", phase.end.peak_rss_kb - phase.start.peak_rss_kb},
+      {"points_in", phase.start.points},
+      {"points_out", phase.end.points},
+      {"points_per_sec", (phase.wall_sec > 0.0) ? points / phase.wall_sec : 0.0},
+      {"bytes_read", phase.end.bytes_read - phase.start.bytes_read},
+      {"bytes_written", phase.end.bytes_written - phase.start.bytes_written}
+    };
+#ifdef GPSBABEL_COUNT_ALLOCATIONS
+    obj.insert("allocations", phase.end.allocations - phase.start.allocations);
+    obj.insert("allocated_bytes", phase.end.allocated_bytes - phase.start.allocated_bytes);
+#endif
+    phases.append(obj);
+    total_wall_sec += phase.wall_sec;
+    total_cpu_usec += phase.end.cpu_usec - phase.start.cpu_usec;
+  }
+
+  Phase::usage_t usage = Phase::current_usage();
+  QJsonObject total{
+    {"wall_sec", total_wall_sec},
+    {"cpu_sec", total_cpu_usec / 1.0e6},
+    {"peak_rss_kb", usage.peak_rss_kb},
+    {"bytes_read", usage.bytes_read},
+    {"bytes_written", usage.bytes_written}
+  };
+#ifdef GPSBABEL_COUNT_ALLOCATIONS
+  total.insert("allocations", usage.allocations);
+  total.insert("allocated_bytes", usage.allocated_bytes);
+#endif
+
+  QJsonObject report{
+    {"version", gpsbabel_version},
+    {"phases", phases},
+    {"total", total}
+  };
+
+  gpsbabel::File file(report_fname_);
+  file.open(QIODevice::WriteOnly);
+  file.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+  file.close();
+}
+
+} // namespace gpsbabel
+
+#ifdef GPSBABEL_COUNT_ALLOCATIONS
+/*
+ * Count the allocations made through operator new.  The array, nothrow and
+ * sized forms of the standard library call these.  Allocations made with
+ * malloc, e.g. by Qt containers, aren't counted.  This is only built with
+ * the GPSBABEL_COUNT_ALLOCATIONS cmake option.
+ */
+void* operator new(std::size_t size)
+{
+  gpsbabel::PerfStats::count_allocation(size);
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    void* p = std::malloc(size);
+    if (p != nullptr) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t /* size */) noexcept
+{
+  std::free(p);
+}
+#endif // GPSBABEL_COUNT_ALLOCATIONS
@@ -0,0 +1,134 @@
+/*
+    Measurements of the readers, filters and writers of a run.
+
+    Copyright (C) 2026 Robert Lipe, robertlipe+source@gpsbabel.org
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ */
+
+#ifndef SRC_CORE_PERFSTATS_H_
+#define SRC_CORE_PERFSTATS_H_
+
+#include <atomic>          // for atomic, memory_order_relaxed
+#include <cstddef>         // for size_t
+
+#include <QElapsedTimer>   // for QElapsedTimer
+#include <QList>           // for QList
+#include <QString>         // for QString
+#include <QtGlobal>        // for qint64
+
+namespace gpsbabel
+{
+
+/*
+ * Wall and CPU time, peak RSS growth, points and file I/O of every reader,
+ * filter and writer run, written as a JSON report at exit.  Builds with
+ * GPSBABEL_COUNT_ALLOCATIONS also report the operator new allocations.
+ * Nothing is recorded until enable() is called; until then the counters
+ * cost a relaxed load of a flag.
+ */
+class PerfStats
+{
+public:
+  /* Types */
+
+  // Measures one phase from construction to destruction.
+  class Phase
+  {
+  public:
+    Phase(const QString& kind, const QString& name, const QString& fname);
+    ~Phase();
+    Phase(const Phase&) = delete;
+    Phase& operator=(const Phase&) = delete;
+    Phase(Phase&&) = delete;
+    Phase& operator=(Phase&&) = delete;
+
+  private:
+    struct usage_t {
+      qint64 cpu_usec{0};
+      qint64 peak_rss_kb{0};
+      qint64 points{0};
+      qint64 allocations{0};
+      qint64 allocated_bytes{0};
+      qint64 bytes_read{0};
+      qint64 bytes_written{0};
+    };
+
+    static usage_t current_usage();
+
+    bool active_;
+    QString kind_;
+    QString name_;
+    QString fname_;
+    QElapsedTimer timer_;
+    usage_t start_;
+
+    friend class PerfStats;
+  };
+
+  /* Member Functions */
+
+  static void enable(const QString& report_fname);
+  static bool enabled()
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  static void count_read(qint64 bytes)
+  {
+    if (enabled()) {
+      bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+  static void count_written(qint64 bytes)
+  {
+    if (enabled()) {
+      bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+  static void count_allocation(std::size_t bytes)
+  {
+    if (enabled()) {
+      allocations_.fetch_add(1, std::memory_order_relaxed);
+      allocated_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+  static void write_report();
+
+private:
+  /* Types */
+
+  struct phase_t {
+    QString kind;
+    QString name;
+    QString fname;
+    double wall_sec;
+    Phase::usage_t start;
+    Phase::usage_t end;
+  };
+
+  /* Data Members */
+
+  static inline std::atomic<bool> enabled_{false};
+  static inline std::atomic<qint64> allocations_{0};
+  static inline std::atomic<qint64> allocated_bytes_{0};
+  static inline std::atomic<qint64> bytes_read_{0};
+  static inline std::atomic<qint64> bytes_written_{0};
+  static inline QString report_fname_;
+  static inline QList<phase_t> phases_;
+};
+
+} // namespace gpsbabel
+#endif // SRC_CORE_PERFSTATS_H_
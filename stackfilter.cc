@@ -26,33 +26,64 @@
 
 #define MYNAME "Stack filter"
 
+void StackFilter::copy_pending_waypts()
+{
+  for (stack_elt* elt = stack; elt != nullptr; elt = elt->next) {
+    if (elt->waypts_pending) {
+      WaypointList* waypt_list_ptr = &(elt->waypts);
+      waypt_backup(&waypt_list_ptr);
+      elt->waypts_pending = false;
+    }
+  }
+}
+
+void StackFilter::copy_pending_routes()
+{
+  for (stack_elt* elt = stack; elt != nullptr; elt = elt->next) {
+    if (elt->routes_pending) {
+      RouteList* route_list_ptr = &(elt->routes);
+      route_backup(&route_list_ptr);
+      elt->routes_pending = false;
+    }
+  }
+}
+
+void StackFilter::copy_pending_tracks()
+{
+  for (stack_elt* elt = stack; elt != nullptr; elt = elt->next) {
+    if (elt->tracks_pending) {
+      RouteList* route_list_ptr = &(elt->tracks);
+      track_backup(&route_list_ptr);
+      elt->tracks_pending = false;
+    }
+  }
+}
+
 void StackFilter::process()
 {
   stack_elt* tmp_elt = nullptr;
-  WaypointList* waypt_list_ptr;
-  RouteList* route_list_ptr;
 
   if (opt_push) {
     tmp_elt = new stack_elt;
     tmp_elt->next = stack;
     stack = tmp_elt;
 
-    waypt_list_ptr = &(tmp_elt->waypts);
-    waypt_backup(&waypt_list_ptr);
-    if (!opt_copy) {
-      waypt_flush_all();
-    }
-
-    route_list_ptr = &(tmp_elt->routes);
-    route_backup(&route_list_ptr);
-    if (!opt_copy) {
-      route_flush_all_routes();
-    }
-
-    route_list_ptr = &(tmp_elt->tracks);
-    track_backup(&route_list_ptr);
-    if (!opt_copy) {
-      route_flush_all_tracks();
+    if (opt_copy) {
+      /*
+       * Each list is copied just before the global one is next changed,
+       * so lists left alone until the pop are never copied at all.
+       */
+      tmp_elt->waypts_pending = true;
+      tmp_elt->routes_pending = true;
+      tmp_elt->tracks_pending = true;
+      waypt_set_mutation_hook([this]() {copy_pending_waypts();});
+      route_set_mutation_hook([this]() {copy_pending_routes();});
+      track_set_mutation_hook([this]() {copy_pending_tracks();});
+    } else {
+      /* Without copy the data just moves onto the stack. */
+      waypt_swap(tmp_elt->waypts);
+      route_swap(tmp_elt->routes);
+      track_swap(tmp_elt->tracks);
     }
 
   } else if (opt_pop) {
@@ -61,20 +92,25 @@ void StackFilter::process()
       fatal(MYNAME ": stack empty\n");
     }
     if (opt_append) {
+      /* The mutation hooks first take the copies that are still pending. */
       waypt_append(&(stack->waypts));
-      stack->waypts.flush();
       route_append(&(stack->routes));
-      stack->routes.flush();
       track_append(&(stack->tracks));
-      stack->tracks.flush();
     } else if (opt_discard) {
       stack->waypts.flush();
       stack->routes.flush();
       stack->tracks.flush();
     } else {
-      waypt_restore(&(stack->waypts));
-      route_restore(&(stack->routes));
-      track_restore(&(stack->tracks));
+      /* A list still pending is the same as the global one. */
+      if (!stack->waypts_pending) {
+        waypt_restore(&(stack->waypts));
+      }
+      if (!stack->routes_pending) {
+        route_restore(&(stack->routes));
+      }
+      if (!stack->tracks_pending) {
+        track_restore(&(stack->tracks));
+      }
     }
 
     stack = tmp_elt->next;
@@ -89,11 +125,16 @@ void StackFilter::process()
       swapdepth--;
     }
 
-    waypt_swap(tmp_elt->waypts);
-
-    route_swap(tmp_elt->routes);
-
-    track_swap(tmp_elt->tracks);
+    /* A list still pending is the same as the global one. */
+    if (!tmp_elt->waypts_pending) {
+      waypt_swap(tmp_elt->waypts);
+    }
+    if (!tmp_elt->routes_pending) {
+      route_swap(tmp_elt->routes);
+    }
+    if (!tmp_elt->tracks_pending) {
+      track_swap(tmp_elt->tracks);
+    }
   }
 }
 
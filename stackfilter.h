@@ -42,6 +42,10 @@ public:
   void exit() override;
 
 private:
+  void copy_pending_waypts();
+  void copy_pending_routes();
+  void copy_pending_tracks();
+
   char* opt_push = nullptr;
   char* opt_copy = nullptr;
   char* opt_pop = nullptr;
@@ -98,6 +102,11 @@ private:
     WaypointList waypts;
     RouteList routes;
     RouteList tracks;
+    // Set while the copy of a list is put off, the list is then still
+    // the same as the global one.
+    bool waypts_pending{false};
+    bool routes_pending{false};
+    bool tracks_pending{false};
     stack_elt* next{nullptr};
   };
   stack_elt* stack = nullptr;
@@ -30,7 +30,9 @@ static constexpr bool TRACKF_DBG = false;
 #include <cstring>                         // for strlen, strchr, strcmp
 #include <ctime>                           // for gmtime, strftime, time_t, tm
 #include <iterator>                        // for next
-#include <utility>                         // for as_const
+#include <queue>                           // for priority_queue
+#include <utility>                         // for as_const, move
+#include <vector>                          // for vector
 
 #include <QByteArray>                      // for QByteArray
 #include <QChar>                           // for QChar
@@ -128,9 +130,10 @@ bool TrackFilter::trackfilter_init_sort_cb(const route_head* ha, const route_hea
   return trackfilter_get_first_time(ha) < trackfilter_get_first_time(hb);
 }
 
-bool TrackFilter::trackfilter_merge_sort_cb(const Waypoint* wa, const Waypoint* wb)
+bool TrackFilter::trackfilter_merge_precedes(const merge_head_t& a, const merge_head_t& b)
 {
-  return wa->GetCreationTime() < wb->GetCreationTime();
+  /* equal times keep the order of the source tracks */
+  return (a.time < b.time) || ((a.time == b.time) && (a.run < b.run));
 }
 
 fix_type TrackFilter::trackfilter_parse_fix(int* nsats)
@@ -336,11 +339,11 @@ void TrackFilter::trackfilter_pack()
       // Steal all the waypoints
       WaypointList curr_wpts;
       track_swap_wpts(curr, curr_wpts);
-      // And add them to the master
-      foreach (Waypoint* wpt, curr_wpts) {
+      // And move them to the master
+      for (Waypoint* wpt : curr_wpts) {
         wpt->wpt_flags.new_trkseg = 0;
-        track_add_wpt(master, wpt);
       }
+      track_splice_wpts(master, curr_wpts);
       track_del_head(curr);
     }
   }
@@ -357,26 +360,45 @@ void TrackFilter::trackfilter_merge()
 
     int original_waypt_count = track_waypt_count();
 
-    QList<Waypoint*> buff;
+    /* Collect the points of each track as a run.  Tracks are nearly
+     * always recorded in time order already; only the others are sorted. */
+    std::vector<merge_run_t> runs;
+    runs.reserve(track_list.size());
 
     auto it = track_list.begin();
-    while (it != track_list.end()) { /* put all points into temp buffer */
+    while (it != track_list.end()) {
       route_head* track = *it;
       // steal all the wpts
       WaypointList wpts;
       track_swap_wpts(track, wpts);
-      // add them to the buff or delete them
+      merge_run_t run;
+      run.points.reserve(wpts.count());
+      bool sorted = true;
+      // add them to the run or delete them
       foreach (Waypoint* wpt, wpts) {
         if (wpt->creation_time.isValid()) {
           // we will put the merged points in one track segment,
           // as it isn't clear how track segments in the original tracks
           // should relate to the merged track.
           wpt->wpt_flags.new_trkseg = 0;
-          buff.append(wpt);
+          const qint64 time = wpt->GetCreationTime().toMSecsSinceEpoch();
+          if (!run.points.empty() && (time < run.points.back().time)) {
+            sorted = false;
+          }
+          run.points.push_back({time, wpt});
         } else {
           delete wpt;
         }
       }
+      if (!sorted) {
+        std::stable_sort(run.points.begin(), run.points.end(),
+        [](const merge_point_t& a, const merge_point_t& b)->bool {
+          return a.time < b.time;
+        });
+      }
+      if (!run.points.empty()) {
+        runs.push_back(std::move(run));
+      }
       if (it != track_list.begin()) {
         track_del_head(track);
         it = track_list.erase(it);
@@ -385,19 +407,47 @@ void TrackFilter::trackfilter_merge()
       }
     }
 
-    std::stable_sort(buff.begin(), buff.end(), trackfilter_merge_sort_cb);
-
-    const Waypoint* prev = nullptr;
+    /* k-way merge of the runs.  Points are taken from the run on top of
+     * the heap for as long as they precede every other run, so runs that
+     * don't overlap in time are simply appended. */
+    auto later = [](const merge_head_t& a, const merge_head_t& b)->bool {
+      return trackfilter_merge_precedes(b, a);
+    };
+    std::priority_queue<merge_head_t, std::vector<merge_head_t>, decltype(later)> heads(later);
+    for (int i = 0; i < static_cast<int>(runs.size()); ++i) {
+      heads.push({runs[i].points.front().time, i});
+    }
 
-    for (auto* wpt : buff) {
-      if ((prev == nullptr) || (prev->GetCreationTime() != wpt->GetCreationTime())) {
-        track_add_wpt(master, wpt);
-        prev = wpt;
-      } else {
-        delete wpt;
+    WaypointList merged;
+    const merge_point_t* prev = nullptr;
+    while (!heads.empty()) {
+      const int r = heads.top().run;
+      heads.pop();
+      merge_run_t& run = runs[r];
+      do {
+        const merge_point_t& pt = run.points[run.next++];
+        if ((prev == nullptr) || (prev->time != pt.time)) {
+          // track points are appended as is, like track_add_wpt does.
+          merged.add_rte_waypt(merged.count(), pt.wpt, false, u"RPT", 3);
+          prev = &pt;
+        } else {
+          delete pt.wpt;
+        }
+      } while ((run.next < run.points.size()) &&
+               (heads.empty() ||
+                trackfilter_merge_precedes({run.points[run.next].time, r}, heads.top())));
+      if (run.next < run.points.size()) {
+        heads.push({run.points[run.next].time, r});
       }
     }
 
+    /* move the merged points into the master track at once */
+    if (!merged.empty()) {
+      // First point in a track is always a new segment.
+      merged.front()->wpt_flags.new_trkseg = 1;
+    }
+    track_swap_wpts(master, merged);
+
     if (master->rte_waypt_empty()) {
       track_del_head(master);
       track_list.clear();
@@ -507,9 +557,9 @@ void TrackFilter::trackfilter_split()
 
     route_head* curr = master;	/* will be reset by first new track */
 
-    // add the first waypoint to the first track
-    track_add_wpt(curr, buff.front());
-    // and add subsequent waypoints to the first track or a new track
+    // the first waypoint starts the first track
+    auto run_begin = buff.cbegin();
+    // and subsequent waypoints continue it or start a new track
     for (auto prev_it = buff.cbegin(), it = std::next(buff.cbegin()); it != buff.cend(); ++prev_it, ++it) {
       const Waypoint* prev_wpt = *prev_it;
       Waypoint* wpt = *it;
@@ -553,14 +603,21 @@ void TrackFilter::trackfilter_split()
         if constexpr(TRACKF_DBG) {
           printf(MYNAME ": splitting new track\n");
         }
+        WaypointList run_wpts;
+        run_wpts.append_range(run_begin, it);
+        track_splice_wpts(curr, run_wpts);
+        run_begin = it;
+
         curr = new route_head;
         trackfilter_split_init_rte_name(curr, wpt->GetCreationTime());
         track_add_head(curr);
         track_list.append(curr);
       }
       wpt->wpt_flags.new_trkseg = 0;
-      track_add_wpt(curr, wpt);
     }
+    WaypointList run_wpts;
+    run_wpts.append_range(run_begin, buff.cend());
+    track_splice_wpts(curr, run_wpts);
   }
 }
 
@@ -769,9 +826,15 @@ void TrackFilter::trackfilter_seg2trk()
       WaypointList src_wpts;
       track_swap_wpts(src, src_wpts);
 
-      // and add them back to the original or a new route_head.
-      foreach (Waypoint* wpt, src_wpts) {
+      // and move each segment back to the original or a new route_head.
+      auto seg_begin = src_wpts.cbegin();
+      for (auto it = src_wpts.cbegin(); it != src_wpts.cend(); ++it) {
+        const Waypoint* wpt = *it;
         if (wpt->wpt_flags.new_trkseg && !first) {
+          WaypointList seg_wpts;
+          seg_wpts.append_range(seg_begin, it);
+          track_splice_wpts(dest, seg_wpts);
+          seg_begin = it;
 
           dest = new route_head;
           dest->rte_num = src->rte_num;
@@ -786,10 +849,11 @@ void TrackFilter::trackfilter_seg2trk()
           insert_point = dest;
           new_track_list.append(dest);
         }
-
-        track_add_wpt(dest, wpt);
         first = false;
       }
+      WaypointList seg_wpts;
+      seg_wpts.append_range(seg_begin, src_wpts.cend());
+      track_splice_wpts(dest, seg_wpts);
     }
     track_list = new_track_list;
   }
@@ -810,15 +874,11 @@ void TrackFilter::trackfilter_trk2seg()
       // steal all the wpts
       WaypointList curr_wpts;
       track_swap_wpts(curr, curr_wpts);
-      // and add them to the master
-      bool first = true;
-      foreach (Waypoint* wpt, curr_wpts) {
-        track_add_wpt(master, wpt);
-        if (first) {
-          wpt->wpt_flags.new_trkseg = 1;
-          first = false;
-        }
+      // and move them to the master as a new segment
+      if (!curr_wpts.empty()) {
+        curr_wpts.front()->wpt_flags.new_trkseg = 1;
       }
+      track_splice_wpts(master, curr_wpts);
       track_del_head(curr);
     }
   }
@@ -22,6 +22,8 @@
 #ifndef TRACKFILTER_H_INCLUDED_
 #define TRACKFILTER_H_INCLUDED_
 
+#include <vector>               // for vector
+
 #include <QDateTime>            // for QDateTime
 #include <QList>                // for QList
 #include <QString>              // for QString
@@ -55,6 +57,22 @@ private:
     bool force{false};
   };
 
+  struct merge_point_t {
+    qint64 time;                        /* creation time, msecs since epoch */
+    Waypoint* wpt;
+  };
+
+  /* The time ordered points of one source track. */
+  struct merge_run_t {
+    std::vector<merge_point_t> points;
+    std::vector<merge_point_t>::size_type next{0};
+  };
+
+  struct merge_head_t {
+    qint64 time;
+    int run;
+  };
+
   /* Constants */
 
   static constexpr double kDistanceLimit = 1.11319; // for points to be considered the same, meters.
@@ -82,7 +100,7 @@ private:
   int trackfilter_opt_count();
   static qint64 trackfilter_parse_time_opt(const char* arg);
   static bool trackfilter_init_sort_cb(const route_head* ha, const route_head* hb);
-  static bool trackfilter_merge_sort_cb(const Waypoint* wa, const Waypoint* wb);
+  static bool trackfilter_merge_precedes(const merge_head_t& a, const merge_head_t& b);
   fix_type trackfilter_parse_fix(int* nsats);
   static QDateTime trackfilter_get_first_time(const route_head* track);
   static QDateTime trackfilter_get_last_time(const route_head* track);
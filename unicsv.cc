@@ -25,6 +25,7 @@
 #include <cstdio>                  // for NULL, sscanf
 #include <ctime>                   // for tm
 #include <utility>                 // for as_const
+#include <vector>                  // for vector
 
 #include <QByteArray>              // for QByteArray
 #include <QChar>                   // for QChar
@@ -46,7 +47,7 @@
 #include "garmin_fs.h"             // for garmin_fs_t
 #include "garmin_tables.h"         // for gt_lookup_datum_index, gt_get_mps_grid_longname, gt_lookup_grid_type
 #include "geocache.h"              // for Geocache, Geocache::status_t, Geoc...
-#include "jeeps/gpsmath.h"         // for GPS_Math_UKOSMap_To_WGS84_M, GPS_Math_EN_To_UKOSNG_Map, GPS_Math_Known_Datum_To_UTM_EN, GPS_Math_Known_Datum_To_WGS84_M, GPS_Math_Swiss_EN_To_WGS84, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS...
+#include "jeeps/gpsmath.h"         // for GPS_Math_UKOSMap_To_WGS84_M, GPS_Math_EN_To_UKOSNG_Map, GPS_Math_Known_Datum_To_UTM_EN, DatumTransform, GPS_Math_Swiss_EN_To_WGS84, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_Swiss_EN, GPS_Math_WGS...
 #include "session.h"               // for session_t
 #include "src/core/datetime.h"     // for DateTime
 #include "src/core/logging.h"      // for Warning, Fatal
@@ -1023,9 +1024,7 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
 
   if ((src_datum != kDautmWGS84) &&
       (wpt->latitude != kUnicsvUnknown) && (wpt->longitude != kUnicsvUnknown)) {
-    double alt;
-    GPS_Math_Known_Datum_To_WGS84_M(wpt->latitude, wpt->longitude, 0.0,
-                                    &wpt->latitude, &wpt->longitude, &alt, src_datum);
+    unicsv_datum_pending.push_back(wpt);
   }
 
   switch (unicsv_data_type) {
@@ -1044,7 +1043,8 @@ UnicsvFormat::unicsv_parse_one_line(const QString& ibuf)
     track_add_wpt(unicsv_track, wpt);
     break;
   default:
-    waypt_add(wpt);
+    /* waypt_add wraps and checks the position, so it has to see WGS84. */
+    unicsv_waypt_pending.push_back(wpt);
   }
 }
 
@@ -1064,6 +1064,16 @@ UnicsvFormat::read()
     }
     unicsv_parse_one_line(buff);
   }
+
+  /* convert all points read in another datum at once. */
+  if (!unicsv_datum_pending.empty()) {
+    DatumTransform::Known_Datum_To_WGS84(unicsv_datum_idx).transform(unicsv_datum_pending);
+    unicsv_datum_pending.clear();
+  }
+  for (Waypoint* wpt : unicsv_waypt_pending) {
+    waypt_add(wpt);
+  }
+  unicsv_waypt_pending.clear();
 }
 
 /* =========================================================================== */
@@ -23,6 +23,7 @@
 
 #include <bitset>                 // for bitset
 #include <cstdint>                // for uint32_t
+#include <vector>                 // for vector
 
 #include <QDate>                  // for QDate
 #include <QDateTime>              // for QDateTime
@@ -197,6 +198,8 @@ private:
   std::bitset<fld_terminator> unicsv_outp_flags;
   grid_type unicsv_grid_idx{grid_unknown};
   int unicsv_datum_idx{};
+  std::vector<Waypoint*> unicsv_datum_pending;	/* read, still in unicsv_datum_idx */
+  std::vector<Waypoint*> unicsv_waypt_pending;	/* read, waypt_add after the conversion */
   char* opt_datum{nullptr};
   char* opt_grid{nullptr};
   char* opt_utc{nullptr};
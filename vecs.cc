@@ -65,6 +65,7 @@
 #include "mtk_logger.h"        // for MtkFormat, MtkM241Format, MtkFileFormat, MtkM241FileFormat
 #include "nmea.h"              // for NmeaFormat
 #include "osm.h"               // for OsmFormat
+#include "osm_pbf.h"           // for OsmPbfFormat
 #include "ozi.h"               // for OziFormat
 #include "qstarz_bl_1000.h"    // for QstarzBL1000Format
 #include "random.h"            // for RandomFormat
@@ -134,6 +135,7 @@ struct Vecs::Impl {
   Dg200SerialFormat dg200_fmt;
   Dg200FileFormat dg200_ffmt;
   OsmFormat osm_fmt;
+  OsmPbfFormat osm_pbf_fmt;
   ExifFormat exif_fmt;
   HumminbirdFormat humminbird_fmt;
   HumminbirdHTFormat humminbird_ht_fmt;
@@ -386,6 +388,13 @@ struct Vecs::Impl {
       "osm",
       nullptr,
     },
+    {
+      &osm_pbf_fmt,
+      "osm_pbf",
+      "OpenStreetMap PBF data files",
+      "pbf",
+      nullptr,
+    },
     {
       &exif_fmt,
       "exif",
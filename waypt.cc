@@ -19,10 +19,15 @@
 
  */
 
+#include <atomic>               // for atomic
 #include <cassert>              // for assert
 #include <cmath>                // for fabs
 #include <cstdio>               // for fflush, fprintf, stdout
-#include <utility>              // for as_const
+#include <functional>           // for function
+#include <iterator>             // for distance
+#include <memory>               // for make_shared, shared_ptr
+#include <utility>              // for as_const, move
+#include <vector>               // for vector
 
 #include <QChar>                // for QChar
 #include <QDateTime>            // for QDateTime
@@ -43,10 +48,18 @@
 #include "session.h"            // for curr_session, session_t
 #include "src/core/datetime.h"  // for DateTime
 #include "src/core/logging.h"   // for FatalMsg
+#include "src/core/nvector.h"   // for NVectorArray
+#include "src/core/parallelsort.h"  // for parallel_stable_sort
 
 
 WaypointList* global_waypoint_list;
 
+/* Bumped to drop every cached result computed from point data. */
+static quint64 computed_epoch = 0;
+
+/* Run before the global waypoints are next changed, see waypt_set_mutation_hook. */
+static std::function<void()> waypt_mutation_hook;
+
 Geocache Waypoint::empty_gc_data;
 
 void
@@ -58,18 +71,21 @@ waypt_init()
 void
 waypt_add(Waypoint* wpt)
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->waypt_add(wpt);
 }
 
 void
 waypt_del(Waypoint* wpt)
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->waypt_del(wpt);
 }
 
 void
 del_marked_wpts()
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->del_marked_wpts();
 }
 
@@ -145,21 +161,40 @@ waypt_compute_bounds(bounds* bounds)
   global_waypoint_list->waypt_compute_bounds(bounds);
 }
 
+quint64
+waypt_computed_epoch()
+{
+  return computed_epoch;
+}
+
+/*
+ * Data computed from the points of a list is cached until the list
+ * changes.  Call this when points may have been modified in place.
+ */
+void
+waypt_invalidate_computed()
+{
+  ++computed_epoch;
+}
+
 Waypoint*
 find_waypt_by_name(const QString& name)
 {
+  waypt_run_mutation_hook();
   return global_waypoint_list->find_waypt_by_name(name);
 }
 
 void
 waypt_flush_all()
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->flush();
 }
 
 void
 waypt_deinit()
 {
+  waypt_mutation_hook = nullptr;
   waypt_flush_all();
   delete global_waypoint_list;
 }
@@ -167,7 +202,13 @@ waypt_deinit()
 void
 waypt_append(WaypointList* src)
 {
-  src->copy(&global_waypoint_list);
+  waypt_run_mutation_hook();
+  // The points themselves move, but still go through waypt_add.
+  WaypointList moved;
+  moved.swap(*src);
+  foreach (Waypoint* wpt, moved) {
+    global_waypoint_list->waypt_add(wpt);
+  }
 }
 
 void
@@ -179,15 +220,48 @@ waypt_backup(WaypointList** head_bak)
 void
 waypt_restore(WaypointList* head_bak)
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->restore(head_bak);
 }
 
 void
 waypt_swap(WaypointList& other)
 {
+  waypt_run_mutation_hook();
   global_waypoint_list->swap(other);
 }
 
+void
+waypt_set_mutation_hook(std::function<void()> hook)
+{
+  waypt_mutation_hook = std::move(hook);
+}
+
+void
+waypt_run_mutation_hook()
+{
+  if (waypt_mutation_hook) {
+    // Run it only once, the hook itself may read the list.
+    std::function<void()> hook = std::move(waypt_mutation_hook);
+    waypt_mutation_hook = nullptr;
+    hook();
+  }
+}
+
+void
+waypt_sort_by_key(qint64 (*key)(const Waypoint*))
+{
+  waypt_run_mutation_hook();
+  global_waypoint_list->sort_by_key(key);
+}
+
+void
+waypt_sort_by_key(QString (*key)(const Waypoint*))
+{
+  waypt_run_mutation_hook();
+  global_waypoint_list->sort_by_key(key);
+}
+
 void
 waypt_add_url(Waypoint* wpt, const QString& link, const QString& url_link_text)
 {
@@ -394,7 +468,12 @@ Waypoint::~Waypoint()
   fs.FsChainDestroy();
 }
 
-Waypoint::Waypoint(const Waypoint& other) :
+/*
+ * Copy every member except the geocache and format specific data, which
+ * are left empty.  The members are listed once, here, for both the copy
+ * constructor and NewInterpolated.
+ */
+Waypoint::Waypoint(const Waypoint& other, shallow_copy_t) :
   geoidheight(other.geoidheight),
   depth(other.depth),
   proximity(other.proximity),
@@ -421,9 +500,16 @@ Waypoint::Waypoint(const Waypoint& other) :
   cadence(other.cadence),
   power(other.power),
   odometer_distance(other.odometer_distance),
-  gc_data(other.gc_data),
+  gc_data(&Waypoint::empty_gc_data),
   session(other.session),
   extra_data(other.extra_data)
+{
+  // note: session is not deep copied.
+  // note: extra_data is not deep copied.
+}
+
+Waypoint::Waypoint(const Waypoint& other) :
+  Waypoint(other, shallow_copy_t())
 {
   // deep copy geocache data unless it is the special static empty_gc_data.
   if (other.gc_data != &Waypoint::empty_gc_data) {
@@ -432,9 +518,22 @@ Waypoint::Waypoint(const Waypoint& other) :
 
   // deep copy fs chain data.
   fs = other.fs.FsChainCopy();
+}
 
-  // note: session is not deep copied.
-  // note: extra_data is not deep copied.
+/*
+ * A new point to be placed between existing ones, e.g. by a filter
+ * interpolating a track.  The position, motion, quality and time fields
+ * are copied from other, and the implicitly shared notes, icon and links
+ * are shared with it.  Names are left empty, and the geocache data and
+ * format specific data, which would have to be deep copied, are not
+ * carried over.
+ */
+Waypoint* Waypoint::NewInterpolated(const Waypoint& other)
+{
+  auto* wpt = new Waypoint(other, shallow_copy_t());
+  wpt->shortname = QString();
+  wpt->description = QString();
+  return wpt;
 }
 
 Waypoint& Waypoint::operator=(const Waypoint& rhs)
@@ -565,6 +664,7 @@ WaypointList::waypt_add(Waypoint* wpt)
   double lat_orig = wpt->latitude;
   double lon_orig = wpt->longitude;
   append(wpt);
+  touch();
 
   if (wpt->latitude < -90) {
     wpt->latitude += 180;
@@ -619,6 +719,7 @@ void
 WaypointList::add_rte_waypt(int waypt_ct, Waypoint* wpt, bool synth, QStringView namepart, int number_digits)
 {
   append(wpt);
+  touch();
 
   if (synth && wpt->shortname.isEmpty()) {
     wpt->shortname = QStringLiteral("%1%2").arg(namepart).arg(waypt_ct, number_digits, 10, QChar('0'));
@@ -632,22 +733,49 @@ WaypointList::waypt_del(Waypoint* wpt)
   const int idx = this->indexOf(wpt);
   assert(idx >= 0);
   removeAt(idx);
+  touch();
 }
 
 void
 WaypointList::del_marked_wpts()
 {
-  // For lineary complexity build a new list from the points we keep.
-  WaypointList oldlist;
-  swap(oldlist);
+  // Stable in-place compaction with linear complexity.  The points we
+  // keep were validated when they were added and are left untouched.
+  auto dest = begin();
+  for (auto it = begin(); it != end(); ++it) {
+    if ((*it)->wpt_flags.marked_for_deletion) {
+      delete *it;
+    } else {
+      *dest++ = *it;
+    }
+  }
+  erase(dest, end());
+  touch();
+}
 
-  for (Waypoint* wpt : std::as_const(oldlist)) {
+void
+WaypointList::del_marked_rte_wpts()
+{
+  // As del_marked_wpts, but mimic trkseg handling from del_rte_waypt.
+  bool inherit_new_trkseg = false;
+  auto dest = begin();
+  for (auto it = begin(); it != end(); ++it) {
+    Waypoint* wpt = *it;
     if (wpt->wpt_flags.marked_for_deletion) {
+      if (wpt->wpt_flags.new_trkseg) {
+        inherit_new_trkseg = true;
+      }
       delete wpt;
     } else {
-      waypt_add(wpt);
+      if (inherit_new_trkseg) {
+        wpt->wpt_flags.new_trkseg = 1;
+        inherit_new_trkseg = false;
+      }
+      *dest++ = wpt;
     }
   }
+  erase(dest, end());
+  touch();
 }
 
 void
@@ -661,6 +789,7 @@ WaypointList::del_rte_waypt(Waypoint* wpt)
   }
   wpt->wpt_flags.new_trkseg = 0;
   removeAt(idx);
+  touch();
 }
 
 /*
@@ -695,6 +824,7 @@ WaypointList::flush()
   while (!isEmpty()) {
     delete takeFirst();
   }
+  touch();
 }
 
 void
@@ -719,6 +849,8 @@ WaypointList::restore(WaypointList* src)
 
   *this = *src;
   src->clear();
+  touch();
+  src->touch();
 }
 
 void WaypointList::swap(WaypointList& other)
@@ -726,4 +858,139 @@ void WaypointList::swap(WaypointList& other)
   const WaypointList tmp_list = *this;
   *this = other;
   other = tmp_list;
+  touch();
+  other.touch();
+}
+
+void WaypointList::append_range(const_iterator first, const_iterator last)
+{
+  reserve(size() + std::distance(first, last));
+  for (auto it = first; it != last; ++it) {
+    append(*it);
+  }
+  touch();
+}
+
+void WaypointList::splice(WaypointList& other)
+{
+  if (isEmpty()) {
+    swap(other);
+  } else {
+    append_range(other.cbegin(), other.cend());
+  }
+  other.clear();
+  other.touch();
+}
+
+void WaypointList::sort_by_key(qint64 (*key)(const Waypoint*))
+{
+  struct keyed_t {
+    qint64 key;
+    Waypoint* wpt;
+  };
+  std::vector<keyed_t> keyed;
+  keyed.reserve(size());
+  for (Waypoint* wpt : std::as_const(*this)) {
+    keyed.push_back({key(wpt), wpt});
+  }
+
+  gpsbabel::parallel_stable_sort(keyed, [](const keyed_t& a, const keyed_t& b)->bool {
+    return a.key < b.key;
+  });
+
+  auto it = begin();
+  for (const auto& k : keyed) {
+    *it++ = k.wpt;
+  }
+  touch();
+}
+
+void WaypointList::sort_by_key(QString (*key)(const Waypoint*))
+{
+  /*
+   * The first four UTF-16 code units, zero padded, packed big endian
+   * order the same way the strings do.  Only equal prefixes need the
+   * strings themselves.
+   */
+  struct keyed_t {
+    quint64 prefix;
+    int index;
+    Waypoint* wpt;
+  };
+  std::vector<QString> strings;
+  std::vector<keyed_t> keyed;
+  strings.reserve(size());
+  keyed.reserve(size());
+  for (Waypoint* wpt : std::as_const(*this)) {
+    strings.push_back(key(wpt));
+    const QString& str = strings.back();
+    quint64 prefix = 0;
+    for (int i = 0; i < 4; ++i) {
+      prefix <<= 16;
+      if (i < str.size()) {
+        prefix |= str.at(i).unicode();
+      }
+    }
+    keyed.push_back({prefix, static_cast<int>(keyed.size()), wpt});
+  }
+
+  gpsbabel::parallel_stable_sort(keyed, [&strings](const keyed_t& a, const keyed_t& b)->bool {
+    if (a.prefix != b.prefix) {
+      return a.prefix < b.prefix;
+    }
+    return strings[a.index] < strings[b.index];
+  });
+
+  auto it = begin();
+  for (const auto& k : keyed) {
+    *it++ = k.wpt;
+  }
+  touch();
+}
+
+const gpsbabel::NVectorArray& WaypointList::nvectors() const
+{
+  if (!nvectors_ ||
+      (nvectors_->generation != generation_) ||
+      (nvectors_->epoch != computed_epoch)) {
+    auto nv = std::make_shared<gpsbabel::NVectorArray>(*this);
+    nv->generation = generation_;
+    nv->epoch = computed_epoch;
+    nvectors_ = std::move(nv);
+  }
+  return *nvectors_;
+}
+
+QList<Waypoint*> WaypointList::session_points(const session_t* se) const
+{
+  if (!session_index_ ||
+      (session_index_->generation != generation_) ||
+      (session_index_->epoch != computed_epoch)) {
+    auto index = std::make_shared<session_index_t>();
+    index->generation = generation_;
+    index->epoch = computed_epoch;
+    for (qsizetype i = 0; i < size(); ++i) {
+      const session_t* session = at(i)->session;
+      if (index->runs.empty() || (index->runs.back().session != session)) {
+        index->runs.push_back({session, i, i + 1});
+      } else {
+        index->runs.back().last = i + 1;
+      }
+    }
+    session_index_ = std::move(index);
+  }
+
+  QList<Waypoint*> points;
+  for (const auto& run : session_index_->runs) {
+    if (run.session == se) {
+      points.append(mid(run.first, run.last - run.first));
+    }
+  }
+  return points;
+}
+
+void WaypointList::touch()
+{
+  static std::atomic<quint64> last_generation{0};
+  generation_ = ++last_generation;
 }
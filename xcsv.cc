@@ -34,6 +34,7 @@
 #include <ctime>                   // for gmtime, localtime, time_t, mktime, strftime
 #include <optional>                // for optional
 #include <utility>                 // for as_const
+#include <vector>                  // for vector
 
 #include <QByteArray>              // for QByteArray
 #include <QChar>                   // for QChar
@@ -56,7 +57,7 @@
 #include "garmin_fs.h"             // for garmin_fs_t
 #include "geocache.h"              // for Geocache, Geocache::status_t, Geoc...
 #include "grtcirc.h"               // for RAD, gcdist, radtometers
-#include "jeeps/gpsmath.h"         // for GPS_Math_WGS84_To_UTM_EN, GPS_Lookup_Datum_Index, GPS_Math_Known_Datum_To_WGS84_M, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_UKOSMap_M
+#include "jeeps/gpsmath.h"         // for GPS_Math_WGS84_To_UTM_EN, GPS_Lookup_Datum_Index, DatumTransform, GPS_Math_UTM_EN_To_Known_Datum, GPS_Math_WGS84_To_Known_Datum_M, GPS_Math_WGS84_To_UKOSMap_M
 #include "jeeps/gpsport.h"         // for int32
 #include "session.h"               // for session_t
 #include "src/core/datetime.h"     // for DateTime
@@ -827,6 +828,11 @@ XcsvFormat::read()
   int linecount = 0;
   route_head* rte = nullptr;
   route_head* trk = nullptr;
+  /* points to convert to WGS84 once they have all been read. */
+  std::vector<Waypoint*> datum_pending;
+  /* waypt_add wraps and checks the position, so waypoints wait for the
+     conversion too. */
+  std::vector<Waypoint*> waypts;
 
   while (true) {
     QString buff = xcsv_file->stream.readLine();
@@ -907,18 +913,14 @@ XcsvFormat::read()
         wpt_tmp->longitude = -wpt_tmp->longitude;
       }
 
-      if ((xcsv_file->gps_datum_idx > -1) && (xcsv_file->gps_datum_idx != kDautmWGS84)) {
-        double alt;
-        GPS_Math_Known_Datum_To_WGS84_M(wpt_tmp->latitude, wpt_tmp->longitude, 0.0,
-                                        &wpt_tmp->latitude, &wpt_tmp->longitude, &alt, xcsv_file->gps_datum_idx);
-      }
-
       if (parse_data.utm_easting || parse_data.utm_northing) {
         GPS_Math_UTM_EN_To_Known_Datum(&wpt_tmp->latitude,
                                        &wpt_tmp->longitude,
                                        parse_data.utm_easting, parse_data.utm_northing,
                                        parse_data.utm_zone, parse_data.utm_zonec,
                                        kDautmWGS84);
+      } else if ((xcsv_file->gps_datum_idx > -1) && (xcsv_file->gps_datum_idx != kDautmWGS84)) {
+        datum_pending.push_back(wpt_tmp);
       }
 
       if (parse_data.link_) {
@@ -930,7 +932,7 @@ XcsvFormat::read()
       switch (xcsv_style->datatype) {
       case unknown_gpsdata:
       case wptdata:
-        waypt_add(wpt_tmp);
+        waypts.push_back(wpt_tmp);
         break;
       case trkdata:
         if ((trk == nullptr) || parse_data.new_track) {
@@ -957,6 +959,13 @@ XcsvFormat::read()
       }
     }
   }
+
+  if (!datum_pending.empty()) {
+    DatumTransform::Known_Datum_To_WGS84(xcsv_file->gps_datum_idx).transform(datum_pending);
+  }
+  for (Waypoint* wpt : waypts) {
+    waypt_add(wpt);
+  }
 }
 
 void